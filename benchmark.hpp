@@ -0,0 +1,205 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "piecewise_counters.hpp"
+
+// Mesures de performance : chronométrage en nanosecondes, exécutions d'échauffement, nombre
+// d'itérations adaptatif et statistiques (médiane, percentiles).
+//
+// measure(setup, op) sépare la préparation de l'opération : pour chaque échantillon, `batch`
+// états sont construits par setup() hors chronométrage (typiquement la copie du profil que op
+// modifie), puis op(état) est chronométré sur tout le lot. La taille du lot double jusqu'à ce
+// qu'un échantillon dure au moins min_batch_ns, pour rester loin de la résolution de l'horloge.
+//
+// Suite rassemble les résultats d'une matrice (backend, opération, taille, paramètre), les écrit
+// en CSV et les compare à un CSV de référence produit par une exécution précédente.
+
+namespace bench {
+
+struct Options {
+    int warmup = 2;                 // lots d'échauffement non mesurés
+    double min_batch_ns = 2e5;      // durée minimale d'un échantillon
+    size_t max_batch = 4096;
+    size_t min_samples = 7;
+    size_t max_samples = 51;
+    double budget_ns = 2e8;         // au-delà, on s'arrête dès min_samples atteint
+};
+
+struct Result {
+    size_t batch = 0;
+    size_t samples = 0;
+    double median_ns = 0, p10_ns = 0, p90_ns = 0, p99_ns = 0, min_ns = 0, mean_ns = 0;
+    uint64_t counters[counters::Counters::COUNT] = {};   // coûts d'une opération (si instrumenté)
+};
+
+// Empêche le compilateur d'éliminer un calcul dont le résultat n'est pas utilisé
+template<typename T>
+inline void keep(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+inline double percentile(const std::vector<double>& sorted, double q) {
+    size_t k = static_cast<size_t>(std::ceil(q * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, k == 0 ? 0 : k - 1)];
+}
+
+template<typename Setup, typename Op>
+Result measure(Setup setup, Op op, const Options& opt = Options()) {
+    using clock = std::chrono::steady_clock;
+    using State = decltype(setup());
+
+    auto run_batch = [&](size_t batch) {
+        std::vector<State> states;
+        states.reserve(batch);
+        for (size_t i = 0; i < batch; ++i) states.push_back(setup());
+        auto start = clock::now();
+        for (State& s : states) op(s);
+        auto end = clock::now();
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    };
+
+    Result r;
+
+    // calibration : lot doublé jusqu'à min_batch_ns
+    size_t batch = 1;
+    double t = run_batch(batch);
+    while (t < opt.min_batch_ns && batch < opt.max_batch) {
+        batch = std::min(opt.max_batch, batch * 2);
+        t = run_batch(batch);
+    }
+    for (int w = 0; w < opt.warmup; ++w) run_batch(batch);
+
+    std::vector<double> samples;
+    double spent = 0.0;
+    while (samples.size() < opt.max_samples && (samples.size() < opt.min_samples || spent < opt.budget_ns)) {
+        double ns = run_batch(batch);
+        spent += ns;
+        samples.push_back(ns / static_cast<double>(batch));
+    }
+
+    std::sort(samples.begin(), samples.end());
+    r.batch = batch;
+    r.samples = samples.size();
+    r.median_ns = percentile(samples, 0.5);
+    r.p10_ns = percentile(samples, 0.1);
+    r.p90_ns = percentile(samples, 0.9);
+    r.p99_ns = percentile(samples, 0.99);
+    r.min_ns = samples.front();
+    double total = 0.0;
+    for (double s : samples) total += s;
+    r.mean_ns = total / static_cast<double>(samples.size());
+
+    // une exécution supplémentaire pour les compteurs d'une seule opération
+    if (counters::ENABLED) {
+        State s = setup();
+        counters::reset();
+        op(s);
+        counters::local().values(r.counters);
+    }
+    return r;
+}
+
+class Suite {
+public:
+    struct Row {
+        std::string backend, operation;
+        size_t size;
+        std::string param;
+        Result result;
+    };
+
+    void add(const std::string& backend, const std::string& operation, size_t size,
+             const std::string& param, const Result& r) {
+        rows.push_back({backend, operation, size, param, r});
+        std::cout << backend << " " << operation << " n=" << size << (param.empty() ? "" : " " + param)
+                  << " : median=" << r.median_ns << "ns p90=" << r.p90_ns << "ns (batch=" << r.batch
+                  << ", samples=" << r.samples << ")" << std::endl;
+    }
+
+    const std::vector<Row>& results() const { return rows; }
+
+    bool write_csv(const std::string& filename) const {
+        std::ofstream out(filename);
+        if (!out) {
+            std::cerr << "Erreur: impossible d'ouvrir le fichier " << filename << std::endl;
+            return false;
+        }
+        out << "backend,operation,size,param,batch,samples,median_ns,p10_ns,p90_ns,p99_ns,min_ns,mean_ns";
+        if (counters::ENABLED) {
+            for (const char* name : counters::NAMES) out << "," << name;
+        }
+        out << "\n";
+        for (const Row& row : rows) {
+            const Result& r = row.result;
+            out << row.backend << "," << row.operation << "," << row.size << "," << row.param << ","
+                << r.batch << "," << r.samples << "," << r.median_ns << "," << r.p10_ns << "," << r.p90_ns
+                << "," << r.p99_ns << "," << r.min_ns << "," << r.mean_ns;
+            if (counters::ENABLED) {
+                for (uint64_t c : r.counters) out << "," << c;
+            }
+            out << "\n";
+        }
+        return true;
+    }
+
+    // Compare les médianes à celles d'un CSV de référence (même format) ; affiche le rapport
+    // courant/référence de chaque ligne commune et renvoie le nombre de lignes plus lentes que
+    // la référence de plus de `threshold` (0.10 = 10 %)
+    size_t compare(const std::string& baseline, double threshold = 0.10) const {
+        std::ifstream in(baseline);
+        if (!in) {
+            std::cerr << "Erreur: impossible d'ouvrir le fichier " << baseline << std::endl;
+            return 0;
+        }
+
+        using Key = std::tuple<std::string, std::string, size_t, std::string>;
+        std::map<Key, double> reference;
+        std::string line;
+        std::getline(in, line);   // en-tête
+        while (std::getline(in, line)) {
+            std::vector<std::string> cells;
+            std::stringstream ss(line);
+            std::string cell;
+            while (std::getline(ss, cell, ',')) cells.push_back(cell);
+            if (cells.size() < 7) continue;
+            reference[Key(cells[0], cells[1], std::stoull(cells[2]), cells[3])] = std::stod(cells[6]);
+        }
+
+        size_t regressions = 0;
+        for (const Row& row : rows) {
+            auto it = reference.find(Key(row.backend, row.operation, row.size, row.param));
+            if (it == reference.end() || it->second <= 0.0) continue;
+            double ratio = row.result.median_ns / it->second;
+            bool slower = ratio > 1.0 + threshold;
+            regressions += slower;
+            std::cout << (slower ? "REGRESSION " : (ratio < 1.0 - threshold ? "gain       " : "           "))
+                      << row.backend << " " << row.operation << " n=" << row.size << " " << row.param
+                      << " : " << it->second << "ns -> " << row.result.median_ns << "ns (x" << ratio << ")"
+                      << std::endl;
+        }
+        return regressions;
+    }
+
+private:
+    std::vector<Row> rows;
+};
+
+}
+
+#endif
@@ -8,10 +8,12 @@ df = pd.read_csv("timing_comparison.csv")
 plt.figure(figsize=(10, 6))
 plt.plot(df["nodes_in_g"], df["time_map_us"], marker='o', label="map_version ")
 plt.plot(df["nodes_in_g"], df["time_list_us"], marker='s', label="list_version ")
+if "time_flat_us" in df:
+    plt.plot(df["nodes_in_g"], df["time_flat_us"], marker='^', label="flat_version ")
 
 plt.xlabel("Number of f points within g")
-plt.ylabel("Execution time (milliseconds)")
-plt.title("Execution Time Comparison: map_version vs list_version")
+plt.ylabel("Execution time (microseconds, median)")
+plt.title("Execution Time Comparison: map_version vs list_version vs flat_version")
 plt.grid(True)
 plt.legend()
 plt.tight_layout()
@@ -46,15 +46,28 @@
 #include <chrono>
 #include <vector>
 #include <fstream>
+#include <shared_mutex>
+#include <thread>
 #include "piecewise.hpp"
 #include "piecewise_map.hpp"
+#include "piecewise_flat.hpp"
+#include "piecewise_parallel.hpp"
+#include "piecewise_expr.hpp"
+#include "piecewise_binary.hpp"
+#include "piecewise_persistent.hpp"
+#include "piecewise_placement.hpp"
+#include "piecewise_multi.hpp"
+#include "piecewise_concurrent.hpp"
+#include "piecewise_compressed.hpp"
+#include "benchmark.hpp"
 
 using namespace std;
 using namespace std::chrono;
 
 // ==================== Génération zigzag ====================
-map_version::PiecewiseLinearFunction zigzag_map(int x_max, double y_min, double y_max, int period) {
-    map_version::PiecewiseLinearFunction f(y_min);
+template<typename X = double>
+map_version::BasicPiecewiseLinearFunction<X> zigzag_map(int x_max, double y_min, double y_max, int period) {
+    map_version::BasicPiecewiseLinearFunction<X> f(y_min);
     for (int x = period; x <= x_max; x += period) {
         double y = ((x / period) % 2 == 0) ? y_min : y_max;
 
@@ -66,14 +79,26 @@ map_version::PiecewiseLinearFunction zigzag_map(int x_max, double y_min, double
     return f;
 }
 
+flat_version::PiecewiseLinearFunction zigzag_flat(int x_max, double y_min, double y_max, int period) {
+    flat_version::PiecewiseLinearFunction f;
+    f.clear();
+    f.reserve(x_max / period + 1);
+    f.push_back(0.0, y_min);
+    for (int x = period; x <= x_max; x += period) {
+        double y = ((x / period) % 2 == 0) ? y_min : y_max;
+        f.push_back(x, y);
+    }
+    return f;
+}
+
 list_version::PiecewiseLinearFunction zigzag_list(int x_max, double y_min, double y_max, int period) {
     list_version::PiecewiseLinearFunction f;
+    f.reserve(x_max / period);
     for (int x = period; x <= x_max; x += period) {
         double y = ((x / period) % 2 == 0) ? y_min : y_max;
         double y_first = ((x / period) % 2 == 0) ? y_max : y_min;
 
-        auto seg = std::make_shared<list_version::Segment>(x-period, y_first , x, y);
-        f.add_segment(seg);
+        f.add_segment(x-period, y_first , x, y);
        //  cout << "segment: last_x=" <<  x-period << " last_y=" << y_first << " x =" << x << " y=" << y << endl;
     
    
@@ -84,8 +109,21 @@ list_version::PiecewiseLinearFunction zigzag_list(int x_max, double y_min, doubl
 
 
 // ==================== Génération delta ====================
-map_version::PiecewiseLinearFunction delta_map(int x_max, int width, double amplitude) {
-    map_version::PiecewiseLinearFunction g;
+template<typename X = double>
+map_version::BasicPiecewiseLinearFunction<X> delta_map(int x_max, int width, double amplitude) {
+    map_version::BasicPiecewiseLinearFunction<X> g;
+    int mid = x_max / 2;
+    int left = mid - width / 2;
+    int right = mid + width / 2;
+    g.removeBreakpoint(X(0));
+    g.addBreakpoint(left, 0);
+    g.addBreakpoint(mid, amplitude);
+    g.addBreakpoint(right, -amplitude);
+    return g;
+}
+
+flat_version::PiecewiseLinearFunction delta_flat(int x_max, int width, double amplitude) {
+    flat_version::PiecewiseLinearFunction g;
     int mid = x_max / 2;
     int left = mid - width / 2;
     int right = mid + width / 2;
@@ -101,32 +139,1868 @@ list_version::PiecewiseLinearFunction delta_list(int x_max, int width, double am
     int mid = x_max / 2;
     int left = mid - width / 2;
     int right = mid + width / 2;
-    auto seg1 = std::make_shared<list_version::Segment>(0, 0, left, 0);
-    auto seg2 = std::make_shared<list_version::Segment>(left, 0, mid, amplitude);
-    auto seg3 = std::make_shared<list_version::Segment>(mid, amplitude, right, 0);
-    auto seg4 = std::make_shared<list_version::Segment>(right, 0, x_max, 0);
-    g.add_segment(seg1);
-    g.add_segment(seg2);
-    g.add_segment(seg3);
-    g.add_segment(seg4);
+    g.reserve(4);
+    g.add_segment(0, 0, left, 0);
+    g.add_segment(left, 0, mid, amplitude);
+    g.add_segment(mid, amplitude, right, 0);
+    g.add_segment(right, 0, x_max, 0);
     return g;
 }
 
-// ==================== Benchmark ====================
-template<typename Func>
-long long benchmark(Func f, int repeat = 1) {
-    long long total = 0;
-    for (int i = 0; i < repeat; i++) {
+// ==================== Benchmark evaluate : parcours linéaire vs index ====================
+// f = zigzag_map de taille croissante, requêtes en des x pseudo-aléatoires sur tout l'horizon
+void benchmark_eval() {
+    ofstream out("eval_comparison.csv");
+    out << "breakpoints,queries,time_linear_us,time_indexed_us,max_abs_diff\n";
+
+    const int queries = 2000;
+    for (int x_max = 1000; x_max <= 64000; x_max *= 2) {
+        auto f_lin = zigzag_map(x_max, 10, 20, 1);
+        auto f_idx = f_lin;
+        f_idx.enableIndex();
+
+        vector<double> xs(queries);
+        unsigned int seed = 12345;
+        for (auto& x : xs) {
+            seed = seed * 1103515245u + 12345u;
+            x = (seed % (100u * x_max)) / 100.0;
+        }
+
+        double acc_lin = 0.0, acc_idx = 0.0, max_diff = 0.0;
         auto start = high_resolution_clock::now();
-        f();
+        for (double x : xs) acc_lin += f_lin.evaluate(x);
+        auto mid_t = high_resolution_clock::now();
+        for (double x : xs) acc_idx += f_idx.evaluate(x);
         auto end = high_resolution_clock::now();
-        total += duration_cast<milliseconds>(end - start).count();
-   
+
+        for (double x : xs) max_diff = max(max_diff, abs(f_lin.evaluate(x) - f_idx.evaluate(x)));
+
+        long long t_lin = duration_cast<microseconds>(mid_t - start).count();
+        long long t_idx = duration_cast<microseconds>(end - mid_t).count();
+        out << f_lin.size() << "," << queries << "," << t_lin << "," << t_idx << "," << max_diff << "\n";
+        cout << "n=" << f_lin.size() << " linear=" << t_lin << "us indexed=" << t_idx
+             << "us diff=" << max_diff << " (" << acc_lin - acc_idx << ")" << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers eval_comparison.csv" << endl;
+}
+
+// ==================== Requêtes d'intervalle : index augmenté ====================
+// Fenêtres [a, a + w] pseudo-aléatoires sur un zigzag de taille croissante. Le comptage de
+// breakpoints est comparé à l'ancien calcul (to_points_cumulative puis filtrage) ; max, intégrale
+// et premier dépassement sont mesurés en mode indexé
+void benchmark_range() {
+    ofstream out("range_comparison.csv");
+    out << "breakpoints,queries,time_points_count_us,time_count_us,time_max_us,time_integral_us,time_first_above_us,count_mismatches\n";
+
+    const int queries = 2000;
+    for (int x_max = 1000; x_max <= 64000; x_max *= 4) {
+        auto f = zigzag_map(x_max, 10, 20, 1);
+        f.sum(map_version::delta_profile(5, x_max / 3, x_max / 2, x_max / 2 + 10));
+        auto f_idx = f;
+        f_idx.enableIndex();
+
+        vector<pair<double, double>> windows(queries);
+        unsigned int seed = 12345;
+        for (auto& w : windows) {
+            seed = seed * 1103515245u + 12345u;
+            w.first = (seed % (100u * x_max)) / 100.0;
+            w.second = w.first + 1 + seed % 500;
+        }
+
+        auto time_us = [](auto&& op) {
+            auto start = high_resolution_clock::now();
+            op();
+            return (long long)duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+        };
+
+        vector<size_t> counted, scanned;
+        double sink = 0.0;
+        // le calcul historique de main() : la fonction entière matérialisée à chaque requête
+        long long t_points = time_us([&] {
+            for (auto& w : windows) {
+                auto points = f.to_points_cumulative();
+                size_t k = 0;
+                for (auto& p : points) if (p.first >= w.first && p.first <= w.second) k++;
+                scanned.push_back(k);
+            }
+        });
+        long long t_count = time_us([&] {
+            for (auto& w : windows) counted.push_back(f_idx.countBreakpoints(w.first, w.second));
+        });
+        long long t_max = time_us([&] {
+            for (auto& w : windows) sink += f_idx.maxOver(w.first, w.second);
+        });
+        long long t_integral = time_us([&] {
+            for (auto& w : windows) sink += f_idx.integral(w.first, w.second);
+        });
+        long long t_first = time_us([&] {
+            for (auto& w : windows) sink += f_idx.firstAbove(w.first, 22.0);
+        });
+        bench::keep(sink);
+
+        size_t mismatches = 0;
+        for (int q = 0; q < queries; q++) mismatches += counted[q] != scanned[q];
+
+        out << f.size() << "," << queries << "," << t_points << "," << t_count << "," << t_max << ","
+            << t_integral << "," << t_first << "," << mismatches << "\n";
+        cout << "n=" << f.size() << " points+filtre=" << t_points << "us count=" << t_count << "us max=" << t_max
+             << "us integral=" << t_integral << "us firstAbove=" << t_first << "us (écarts de comptage : "
+             << mismatches << ")" << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers range_comparison.csv" << endl;
+}
+
+// ==================== Placement au plus tôt ====================
+// Profil chargé de tâches aléatoires, capacité constante : premier début réalisable d'une tâche
+// par la requête dédiée (earliest_start, sans écriture) contre les essais sum/vérification/restore
+// sur une grille de pas 0.25 (profil indexé pour que la vérification soit en O(log n))
+void benchmark_placement() {
+    ofstream out("placement_comparison.csv");
+    out << "loaded_tasks,breakpoints,queries,time_query_us,time_trial_us,trial_sums,later_than_trial,infeasible\n";
+
+    const int queries = 200;
+    const double capacity = 12;
+    const double step = 0.25;
+    for (int loaded = 1000; loaded <= 16000; loaded *= 4) {
+        const int horizon = 20000;
+        auto f = map_version::cba_profile(0, 0, 1);
+        unsigned int seed = 4242;
+        auto next = [&] { return seed = seed * 1103515245u + 12345u; };
+        for (int i = 0; i < loaded; i++) {
+            double a = (next() >> 8) % (horizon - 10) + 0.5;
+            f.sum(map_version::delta_profile(1 + next() % 6, a, a + 1 + next() % 3, a + 5));
+        }
+        f.enableIndex();
+        auto cap = map_version::cba_profile(capacity, 0, 1);
+
+        vector<placement::TaskShape> shapes;
+        vector<double> releases;
+        for (int q = 0; q < queries; q++) {
+            shapes.push_back({2.0 + next() % 6, 0.0, 1.0 + next() % 4, 6.0 + next() % 4});
+            releases.push_back(10 + (next() >> 8) % (horizon - 1000));
+        }
+
+        vector<double> found(queries), tried(queries);
+        auto start = high_resolution_clock::now();
+        for (int q = 0; q < queries; q++) found[q] = placement::earliest_start(f, shapes[q], cap, releases[q]);
+        auto mid_t = high_resolution_clock::now();
+        counters::reset();
+        for (int q = 0; q < queries; q++) {
+            tried[q] = placement::earliest_start_by_trial(f, shapes[q], capacity, releases[q], step, 100000);
+        }
+        auto end = high_resolution_clock::now();
+        size_t sums = counters::local().sum_calls;
+        f.discardTrail();
+
+        // la requête ne doit jamais être plus tardive que la grille, et son résultat doit passer l'essai
+        size_t later = 0, infeasible = 0;
+        for (int q = 0; q < queries; q++) {
+            later += found[q] > tried[q] + map_version::EPSILON;
+            infeasible += placement::earliest_start_by_trial(f, shapes[q], capacity, found[q], step, 1) != found[q];
+        }
+        f.discardTrail();
+
+        long long t_query = duration_cast<microseconds>(mid_t - start).count();
+        long long t_trial = duration_cast<microseconds>(end - mid_t).count();
+        out << loaded << "," << f.size() << "," << queries << "," << t_query << "," << t_trial << ","
+            << (counters::ENABLED ? to_string(sums) : "") << "," << later << "," << infeasible << "\n";
+        cout << "tâches=" << loaded << " (" << f.size() << " points) requête=" << t_query << "us essais=" << t_trial
+             << "us plus tard que la grille=" << later << " non réalisables=" << infeasible << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers placement_comparison.csv" << endl;
+}
+
+// ==================== Profils multi-ressources ====================
+// K ressources : K fonctions map_version (K fusions par tâche) contre une fonction à K voies
+// (une fusion), pour l'ajout de tâches, l'évaluation et le contrôle de capacité sur une fenêtre
+template<size_t K>
+void run_multi(ofstream& out) {
+    const int horizon = 20000;
+    const int loaded = 5000;
+    const int added = 1000;
+    const int queries = 200;
+
+    unsigned int seed = 99;
+    auto next = [&] { return seed = seed * 1103515245u + 12345u; };
+    auto task = [&](multi_version::Values<K>& gap, double& a) {
+        a = (next() >> 8) % (horizon - 10) + 0.5;
+        for (size_t k = 0; k < K; k++) gap[k] = next() % 4;
+    };
+
+    vector<map_version::PiecewiseLinearFunction> separate(K, map_version::PiecewiseLinearFunction(0.0));
+    multi_version::PiecewiseLinearFunction<K> shared(0.0);
+    for (int i = 0; i < loaded; i++) {
+        multi_version::Values<K> gap;
+        double a;
+        task(gap, a);
+        for (size_t k = 0; k < K; k++) separate[k].sum(map_version::delta_profile(gap[k], a, a + 2, a + 4.5));
+        shared.sum(multi_version::delta_profile(gap, a, a + 2, a + 4.5));
+    }
+
+    vector<pair<multi_version::Values<K>, double>> tasks(added);
+    for (auto& t : tasks) task(t.first, t.second);
+    vector<double> xs(queries);
+    for (auto& x : xs) x = (next() % (100u * horizon)) / 100.0;
+
+    auto time_us = [](auto&& op) {
+        auto start = high_resolution_clock::now();
+        op();
+        return (long long)duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    };
+
+    long long t_sum_sep = time_us([&] {
+        for (auto& t : tasks) {
+            for (size_t k = 0; k < K; k++) {
+                separate[k].sum(map_version::delta_profile(t.first[k], t.second, t.second + 2, t.second + 4.5));
+            }
+        }
+    });
+    long long t_sum_multi = time_us([&] {
+        for (auto& t : tasks) shared.sum(multi_version::delta_profile(t.first, t.second, t.second + 2, t.second + 4.5));
+    });
+
+    vector<double> sep_values(queries * K), multi_values(queries * K);
+    long long t_eval_sep = time_us([&] {
+        for (int q = 0; q < queries; q++) {
+            for (size_t k = 0; k < K; k++) sep_values[q * K + k] = separate[k].evaluate(xs[q]);
+        }
+    });
+    long long t_eval_multi = time_us([&] {
+        for (int q = 0; q < queries; q++) {
+            auto v = shared.evaluate(xs[q]);
+            for (size_t k = 0; k < K; k++) multi_values[q * K + k] = v[k];
+        }
+    });
+
+    // contrôle de capacité : toutes les ressources sous 20 sur [x, x + 50]
+    auto cap = multi_version::Values<K>::broadcast(20.0);
+    size_t fits_sep = 0, fits_multi = 0;
+    long long t_fit_sep = time_us([&] {
+        for (int q = 0; q < queries; q++) {
+            bool ok = true;
+            for (size_t k = 0; k < K && ok; k++) {
+                double peak = max(separate[k].evaluate(xs[q]), separate[k].evaluate(xs[q] + 50));
+                double y = 0.0;
+                for (const auto& kv : separate[k]) {
+                    if (kv.first > xs[q] + 50) break;
+                    y += kv.second;
+                    if (kv.first >= xs[q]) peak = max(peak, y);
+                }
+                ok = peak <= 20.0;
+            }
+            fits_sep += ok;
+        }
+    });
+    long long t_fit_multi = time_us([&] {
+        for (int q = 0; q < queries; q++) fits_multi += shared.fits(cap, xs[q], xs[q] + 50);
+    });
+
+    size_t mismatches = (fits_sep != fits_multi);
+    for (int i = 0; i < queries * (int)K; i++) mismatches += sep_values[i] != multi_values[i];
+
+    // aller-retour from / resource sur des ressources qui ne commencent pas au même x
+    vector<map_version::PiecewiseLinearFunction> staggered(K);
+    for (auto& r : staggered) {
+        r.clear();
+        for (int i = 0; i < 20; i++) {
+            multi_version::Values<K> gap;
+            double a;
+            task(gap, a);
+            r.sum(map_version::delta_profile(gap[0] + 1, a, a + 2, a + 4.5));
+        }
+    }
+    auto grouped = multi_version::PiecewiseLinearFunction<K>::from(staggered.data());
+    double roundtrip_error = 0.0;
+    for (size_t k = 0; k < K; k++) {
+        auto back = grouped.resource(k);
+        for (double x : xs) {
+            double expected = staggered[k].evaluate(x);
+            roundtrip_error = max(roundtrip_error, abs(grouped.evaluate(x)[k] - expected));
+            roundtrip_error = max(roundtrip_error, abs(back.evaluate(x) - expected));
+        }
+    }
+
+    size_t sep_points = 0;
+    for (auto& f : separate) sep_points += f.size();
+    out << K << "," << shared.size() << "," << sep_points << "," << t_sum_sep << "," << t_sum_multi << "," << t_eval_sep
+        << "," << t_eval_multi << "," << t_fit_sep << "," << t_fit_multi << "," << mismatches << "," << roundtrip_error << "\n";
+    cout << "K=" << K << " : points " << sep_points << " (séparés) / " << shared.size() << " (partagés) ; sum "
+         << t_sum_sep << "us -> " << t_sum_multi << "us ; evaluate " << t_eval_sep << "us -> " << t_eval_multi
+         << "us ; fits " << t_fit_sep << "us -> " << t_fit_multi << "us ; écarts=" << mismatches
+         << " ; aller-retour from/resource err=" << roundtrip_error << endl;
+}
+
+void benchmark_multi() {
+    ofstream out("multi_comparison.csv");
+    out << "resources,shared_points,separate_points,time_sum_separate_us,time_sum_multi_us,time_eval_separate_us,"
+           "time_eval_multi_us,time_fits_separate_us,time_fits_multi_us,mismatches,roundtrip_max_error\n";
+    run_multi<8>(out);
+    run_multi<16>(out);
+    out.close();
+    cout << "Données exportées vers multi_comparison.csv" << endl;
+}
+
+// ==================== Transformations affines paresseuses ====================
+// Placement d'une tâche : delta_profile reconstruit à chaque début contre un gabarit décalé (tag),
+// puis sum dans f ; mise à l'échelle et translation d'un grand profil : réécriture de tous les
+// breakpoints (materialize) contre le tag O(1), suivi d'évaluations
+void benchmark_affine() {
+    ofstream out("affine_comparison.csv");
+    out << "operation,breakpoints,count,eager_us,lazy_us,max_abs_diff\n";
+
+    auto time_us = [](auto&& op) {
+        auto start = high_resolution_clock::now();
+        op();
+        return (long long)duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    };
+    auto row = [&](const string& op, size_t n, size_t count, long long eager, long long lazy, double diff) {
+        out << op << "," << n << "," << count << "," << eager << "," << lazy << "," << diff << "\n";
+        cout << op << " n=" << n << " x" << count << " : réécriture=" << eager << "us tag=" << lazy
+             << "us diff=" << diff << endl;
+    };
+
+    for (int x_max = 4000; x_max <= 256000; x_max *= 4) {
+        auto f = zigzag_map(x_max, 10, 20, 1);
+        vector<double> xs;
+        for (double x = -5; x <= x_max + 5; x += 7.3) xs.push_back(x);
+
+        // placement de tâches
+        const int tasks = 5000;
+        vector<double> starts(tasks);
+        unsigned int seed = 31;
+        for (auto& t : starts) {
+            seed = seed * 1103515245u + 12345u;
+            t = (seed >> 8) % (x_max - 10) + 0.5;
+        }
+        auto f_eager = f, f_lazy = f;
+        long long t_build = time_us([&] {
+            for (double t : starts) f_eager.sum(map_version::delta_profile(3, t, t + 2, t + 4.5));
+        });
+        auto task = map_version::delta_profile(3, 0, 2, 4.5);
+        long long t_shift = time_us([&] {
+            double at = 0.0;
+            for (double t : starts) {
+                task.shift(t - at);
+                at = t;
+                f_lazy.sum(task);
+            }
+        });
+        auto a = f_eager.evaluate_many(xs), b = f_lazy.evaluate_many(xs);
+        double diff = 0.0;
+        for (size_t k = 0; k < xs.size(); k++) diff = max(diff, abs(a[k] - b[k]));
+        row("place_task", f.size(), tasks, t_build, t_shift, diff);
+
+        // mise à l'échelle puis translation, suivies de quelques évaluations
+        const int queries = 100;
+        double sink = 0.0;
+        auto scaled_eager = f, scaled_lazy = f;
+        long long t_rewrite = time_us([&] {
+            scaled_eager.scale(1.5);
+            scaled_eager.offset(2.0);
+            scaled_eager.materialize();
+            for (int q = 0; q < queries; q++) sink += scaled_eager.evaluate(xs[q * 7 % xs.size()]);
+        });
+        long long t_tag = time_us([&] {
+            scaled_lazy.scale(1.5);
+            scaled_lazy.offset(2.0);
+            for (int q = 0; q < queries; q++) sink += scaled_lazy.evaluate(xs[q * 7 % xs.size()]);
+        });
+        bench::keep(sink);
+        a = scaled_eager.evaluate_many(xs);
+        b = scaled_lazy.evaluate_many(xs);
+        diff = 0.0;
+        for (size_t k = 0; k < xs.size(); k++) diff = max(diff, abs(a[k] - b[k]));
+        row("scale_offset", f.size(), 1, t_rewrite, t_tag, diff);
+    }
+
+    out.close();
+    cout << "Données exportées vers affine_comparison.csv" << endl;
+}
+
+// ==================== Profil partagé : lecteurs concurrents ====================
+// Un writer publie jusqu'à `updates` tâches (1 s au plus) pendant que `readers` threads évaluent en boucle. Chaque lecture
+// évalue deux sondes dans la même version et les compare aux valeurs de cette version calculées
+// séquentiellement : une violation signale une lecture déchirée ou une version libérée trop tôt.
+// Référence : verrou lecteurs/écrivain autour d'un map_version indexé modifié en place ; les lecteurs
+// y affament le writer, qui abandonne à l'échéance (writes < updates).
+struct ConcurrentRun {
+    double reads_per_s = 0, writes_per_s = 0;
+    size_t reads = 0, writes = 0, violations = 0;
+};
+
+// make_reader(r) donne la lecture du thread r : bool(size_t n), false si incohérente ;
+// write(i, deadline) publie la tâche i, false si l'échéance est passée avant
+template<typename MakeReader, typename Write>
+ConcurrentRun run_concurrent(unsigned readers, size_t updates, MakeReader make_reader, Write write) {
+    atomic<bool> done{false};
+    atomic<unsigned> ready{0};
+    atomic<size_t> reads{0}, violations{0};
+    vector<thread> threads;
+    for (unsigned r = 0; r < readers; r++) {
+        threads.emplace_back([&, r] {
+            auto read = make_reader(r);
+            size_t n = 0, bad = 0;
+            ready++;
+            while (!done.load(memory_order_relaxed)) {
+                bad += !read(n);
+                n++;
+            }
+            reads += n;
+            violations += bad;
+        });
+    }
+    while (ready.load() < readers) this_thread::yield();
+
+    ConcurrentRun run;
+    auto start = high_resolution_clock::now();
+    auto deadline = start + seconds(1);
+    while (run.writes < updates && high_resolution_clock::now() < deadline && write(run.writes, deadline)) {
+        run.writes++;
+    }
+    double elapsed = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+    done = true;
+    for (auto& t : threads) t.join();
+
+    run.reads = reads;
+    run.violations = violations;
+    run.reads_per_s = run.reads / elapsed;
+    run.writes_per_s = run.writes / elapsed;
+    return run;
+}
+
+void benchmark_concurrent() {
+    ofstream out("concurrent_comparison.csv");
+    out << "method,base_points,readers,writes,reads_per_s,writes_per_s,reads,violations,retired_left\n";
+
+    const int x_max = 16000;
+    const size_t updates = 400;
+    const size_t probe_count = 16;
+
+    auto base = zigzag_map(x_max, 10, 20, 1);
+    base.enableIndex();
+    vector<map_version::PiecewiseLinearFunction> tasks;
+    unsigned int seed = 4242;
+    for (size_t i = 0; i < updates; i++) {
+        seed = seed * 1103515245u + 12345u;
+        double a = (seed >> 8) % (x_max - 10) + 0.5;
+        tasks.push_back(map_version::delta_profile(1 + seed % 5, a, a + 3, a + 7.5));
+    }
+    vector<double> probes;
+    for (size_t k = 0; k < probe_count; k++) probes.push_back(1.25 + k * (x_max - 2.5) / (probe_count - 1));
+
+    // valeurs attendues aux sondes après chaque version, calculées séquentiellement
+    auto expected_for = [&](auto f) {
+        vector<vector<double>> expected;
+        for (size_t i = 0; i <= updates; i++) {
+            if (i > 0) f.sum(tasks[i - 1]);
+            vector<double> row;
+            for (double x : probes) row.push_back(f.evaluate(x));
+            expected.push_back(row);
+        }
+        return expected;
+    };
+    auto expected_map = expected_for(base);
+    auto expected_persistent = expected_for(persistent_version::PiecewiseLinearFunction(base));
+
+    auto matches = [&](const vector<vector<double>>& expected, uint64_t v, size_t k, double y) {
+        return v < expected.size() && abs(y - expected[v][k]) <= 1e-9 * max(1.0, abs(expected[v][k]));
+    };
+
+    auto row = [&](const string& method, unsigned readers, const ConcurrentRun& run, size_t retired) {
+        out << method << "," << base.size() << "," << readers << "," << run.writes << "," << run.reads_per_s
+            << "," << run.writes_per_s << "," << run.reads << "," << run.violations << "," << retired << "\n";
+        cout << method << " readers=" << readers << " : " << (long long)run.reads_per_s << " lectures/s, "
+             << (long long)run.writes_per_s << " écritures/s, violations=" << run.violations
+             << " retirées=" << retired << endl;
+    };
+
+    for (unsigned readers : {1u, 2u, 4u, 8u, 16u}) {
+        {
+            auto f = base;
+            uint64_t number = 0;
+            shared_timed_mutex lock;
+            auto run = run_concurrent(readers, updates,
+                [&](unsigned) {
+                    return [&](size_t n) {
+                        shared_lock<shared_timed_mutex> guard(lock);
+                        size_t k1 = n % probe_count, k2 = (n + probe_count / 2) % probe_count;
+                        return matches(expected_map, number, k1, f.evaluate(probes[k1])) &&
+                               matches(expected_map, number, k2, f.evaluate(probes[k2]));
+                    };
+                },
+                [&](size_t i, high_resolution_clock::time_point deadline) {
+                    unique_lock<shared_timed_mutex> guard(lock, deadline);
+                    if (!guard.owns_lock()) return false;
+                    f.sum(tasks[i]);
+                    number++;
+                    return true;
+                });
+            row("rwlock_map", readers, run, 0);
+        }
+
+        auto rcu = [&](const string& method, auto initial, const vector<vector<double>>& expected) {
+            concurrent_version::SharedProfile<decltype(initial)> shared(initial);
+            auto run = run_concurrent(readers, updates,
+                [&](unsigned) {
+                    return [&, reader = shared.reader()](size_t n) {
+                        auto snap = reader.pin();
+                        size_t k1 = n % probe_count, k2 = (n + probe_count / 2) % probe_count;
+                        return matches(expected, snap.version(), k1, snap->evaluate(probes[k1])) &&
+                               matches(expected, snap.version(), k2, snap->evaluate(probes[k2]));
+                    };
+                },
+                [&](size_t i, high_resolution_clock::time_point) {
+                    shared.update([&](auto& f) { f.sum(tasks[i]); });
+                    return true;
+                });
+            shared.reclaim();   // plus aucun lecteur : tout doit être libéré
+            row(method, readers, run, shared.retiredCount());
+        };
+        rcu("rcu_map", base, expected_map);
+        rcu("rcu_persistent", persistent_version::PiecewiseLinearFunction(base), expected_persistent);
+    }
+
+    out.close();
+    cout << "Données exportées vers concurrent_comparison.csv" << endl;
+}
+
+// ==================== Benchmark somme de N profils de tâches ====================
+// sum_all/add_all (une passe) contre des sum/add répétés ; les sommes répétées, quadratiques,
+// ne sont mesurées que jusqu'à repeat_max tâches (-1 dans le CSV au-delà)
+void benchmark_batch() {
+    ofstream out("batch_comparison.csv");
+    out << "tasks,time_map_repeated_us,time_map_batch_us,time_list_repeated_us,time_list_batch_us\n";
+
+    const double horizon = 100000;
+    const int map_repeat_max = 100000;
+    const int list_repeat_max = 1000;
+
+    for (int tasks = 10; tasks <= 1000000; tasks *= 10) {
+        vector<map_version::PiecewiseLinearFunction> maps;
+        vector<list_version::PiecewiseLinearFunction> lists;
+        maps.reserve(tasks);
+        lists.reserve(tasks);
+
+        unsigned int seed = 12345;
+        auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return (seed >> 8); };
+        for (int i = 0; i < tasks; i++) {
+            double a = next() % (unsigned int)(horizon - 200);
+            double b = a + 1 + next() % 100;
+            double c = b + 1 + next() % 100;
+            double gap = 1 + next() % 10;
+            maps.push_back(map_version::delta_profile(gap, a, b, c));
+            lists.push_back(list_version::delta_profile_temp(gap, a, b, c, horizon));
+        }
+
+        long long t_map_rep = -1, t_list_rep = -1;
+        if (tasks <= map_repeat_max) {
+            auto start = high_resolution_clock::now();
+            map_version::PiecewiseLinearFunction acc;
+            for (const auto& p : maps) acc.sum(p);
+            t_map_rep = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+        }
+        auto start = high_resolution_clock::now();
+        auto map_total = map_version::sum_all(maps);
+        long long t_map_batch = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        if (tasks <= list_repeat_max) {
+            start = high_resolution_clock::now();
+            list_version::PiecewiseLinearFunction acc = lists[0];
+            for (size_t i = 1; i < lists.size(); i++) acc.add(lists[i]);
+            t_list_rep = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+        }
+        start = high_resolution_clock::now();
+        auto list_total = list_version::add_all(lists);
+        long long t_list_batch = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        out << tasks << "," << t_map_rep << "," << t_map_batch << "," << t_list_rep << "," << t_list_batch << "\n";
+        cout << "tasks=" << tasks << " map repeated=" << t_map_rep << "us batch=" << t_map_batch
+             << "us (" << map_total.size() << " pts) list repeated=" << t_list_rep << "us batch=" << t_list_batch
+             << "us (" << list_total.pool.size() << " segs)" << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers batch_comparison.csv" << endl;
+}
+
+// ==================== Benchmark retour arrière : copie vs checkpoint/restore ====================
+// Pour chaque noeud de recherche : ajouter un delta_profile puis revenir à l'état précédent
+void benchmark_undo() {
+    ofstream out("undo_comparison.csv");
+    out << "breakpoints,nodes,time_copy_us,time_trail_us,restored_ok\n";
+
+    const int nodes = 200;
+    for (int x_max = 4000; x_max <= 256000; x_max *= 4) {
+        auto f = zigzag_map(x_max, 10, 20, 1);
+        auto reference = f.to_points_cumulative();
+
+        vector<map_version::PiecewiseLinearFunction> tasks;
+        unsigned int seed = 12345;
+        for (int i = 0; i < nodes; i++) {
+            seed = seed * 1103515245u + 12345u;
+            double a = (seed >> 8) % (x_max - 20) + 0.5;
+            tasks.push_back(map_version::delta_profile(5, a, a + 5, a + 10));
+        }
+
+        auto start = high_resolution_clock::now();
+        for (const auto& g : tasks) {
+            auto tmp = f;
+            tmp.sum(g);
+        }
+        long long t_copy = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        start = high_resolution_clock::now();
+        for (const auto& g : tasks) {
+            size_t cp = f.checkpoint();
+            f.sum(g);
+            f.restore(cp);
+        }
+        long long t_trail = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+        f.discardTrail();
+
+        bool ok = (f.to_points_cumulative() == reference);
+        out << f.size() << "," << nodes << "," << t_copy << "," << t_trail << "," << ok << "\n";
+        cout << "n=" << f.size() << " copy=" << t_copy << "us trail=" << t_trail
+             << "us restored=" << (ok ? "yes" : "NO") << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers undo_comparison.csv" << endl;
+}
+
+// ==================== Benchmark réduction parallèle ====================
+// Accélération de parallel::sum_all/add_all selon le nombre de threads ; le résultat doit être
+// identique bit à bit à celui obtenu avec un seul thread
+void benchmark_parallel() {
+    ofstream out("parallel_comparison.csv");
+    out << "tasks,threads,time_map_us,time_list_us,identical\n";
+
+    const double horizon = 100000;
+    for (int tasks = 10000; tasks <= 1000000; tasks *= 10) {
+        vector<map_version::PiecewiseLinearFunction> maps;
+        vector<list_version::PiecewiseLinearFunction> lists;
+        maps.reserve(tasks);
+        lists.reserve(tasks);
+
+        unsigned int seed = 12345;
+        auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return (seed >> 8); };
+        for (int i = 0; i < tasks; i++) {
+            double a = next() % (unsigned int)(horizon - 200);
+            double b = a + 1 + next() % 100;
+            double c = b + 1 + next() % 100;
+            double gap = 1 + next() % 10;
+            maps.push_back(map_version::delta_profile(gap, a, b, c));
+            lists.push_back(list_version::delta_profile_temp(gap, a, b, c, horizon));
+        }
+
+        vector<pair<double, double>> map_ref;
+        vector<list_version::Segment> list_ref;
+        for (unsigned threads = 1; threads <= 32; threads *= 2) {
+            ThreadPool pool(threads);
+
+            auto start = high_resolution_clock::now();
+            auto map_total = parallel::sum_all(maps, pool);
+            long long t_map = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+            start = high_resolution_clock::now();
+            auto list_total = parallel::add_all(lists, pool);
+            long long t_list = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+            auto map_points = map_total.to_points_cumulative();
+            vector<list_version::Segment> list_segments;
+            for (uint32_t s = list_total.head; s != list_version::NIL; s = list_total.segment(s).next) {
+                list_segments.push_back(list_total.segment(s));
+                list_segments.back().next = list_version::NIL;
+            }
+            if (threads == 1) {
+                map_ref = map_points;
+                list_ref = list_segments;
+            }
+            bool identical = (map_points == map_ref) && list_segments.size() == list_ref.size() &&
+                equal(list_segments.begin(), list_segments.end(), list_ref.begin(),
+                      [](const list_version::Segment& a, const list_version::Segment& b) {
+                          return a.x_left == b.x_left && a.y_left == b.y_left &&
+                                 a.x_right == b.x_right && a.y_right == b.y_right;
+                      });
+
+            out << tasks << "," << threads << "," << t_map << "," << t_list << "," << identical << "\n";
+            cout << "tasks=" << tasks << " threads=" << threads << " map=" << t_map << "us list=" << t_list
+                 << "us identical=" << (identical ? "yes" : "NO") << endl;
+        }
+    }
+
+    out.close();
+    cout << "Données exportées vers parallel_comparison.csv" << endl;
+}
+
+// ==================== Benchmark somme segmentée parallèle ====================
+// Une seule somme f + g de deux grands profils entrelacés : f.sum(g) séquentiel (copie de f hors
+// chronométrage) contre parallel::sum selon le nombre de threads. Mêmes breakpoints attendus,
+// valeurs aux arrondis près, et résultat identique bit à bit d'un nombre de threads à l'autre.
+void benchmark_segmented_sum() {
+    ofstream out("segmented_sum_comparison.csv");
+    out << "points_f,points_g,threads,time_seq_us,time_par_us,same_breakpoints,max_abs_diff,identical_threads\n";
+
+    for (int n = 250000; n <= 2000000; n *= 2) {
+        // f : zigzag entier, g : zigzag décalé d'un tiers de pas (aucune abscisse commune sauf 0)
+        auto f = zigzag_map(n, 10, 20, 1);
+        map_version::PiecewiseLinearFunction g;
+        g.clear();
+        for (int k = 0; k < n; k++) g.appendBreakpoint(k + 1.0 / 3, (k % 2 == 0) ? 5.0 : -5.0);
+
+        auto f_seq = f;
+        auto start = high_resolution_clock::now();
+        f_seq.sum(g);
+        long long t_seq = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+        auto expected = f_seq.to_points_cumulative();
+
+        vector<pair<double, double>> reference;
+        for (unsigned threads = 1; threads <= 32; threads *= 2) {
+            ThreadPool pool(threads);
+            start = high_resolution_clock::now();
+            auto total = parallel::sum(f, g, pool);
+            long long t_par = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+            auto points = total.to_points_cumulative();
+            bool same = points.size() == expected.size();
+            double diff = 0.0;
+            for (size_t k = 0; same && k < points.size(); k++) {
+                same = points[k].first == expected[k].first;
+                diff = max(diff, abs(points[k].second - expected[k].second));
+            }
+            if (threads == 1) reference = points;
+            bool identical = points == reference;
+
+            out << f.size() << "," << g.size() << "," << threads << "," << t_seq << "," << t_par << ","
+                << same << "," << diff << "," << identical << "\n";
+            cout << "f=" << f.size() << " g=" << g.size() << " threads=" << threads << " séquentiel=" << t_seq
+                 << "us parallèle=" << t_par << "us mêmes_points=" << (same ? "yes" : "NO") << " diff=" << diff
+                 << " identique=" << (identical ? "yes" : "NO") << endl;
+        }
+    }
+
+    out.close();
+    cout << "Données exportées vers segmented_sum_comparison.csv" << endl;
+}
+
+// ==================== Trace d'opérations : enregistrement et rejeu ====================
+// ./test trace [fichier] : rejoue une trace enregistrée (piecewise_trace.hpp) sur map_version et
+// flat_version, latences par opération (médiane, p90, p99). Sans fichier, enregistre d'abord une
+// charge de planification synthétique dans workload.trace (compilation avec -DPIECEWISE_TRACE) :
+// tâches ajoutées puis retirées (sum de la tâche mise à l'échelle -1), évaluations ponctuelles et
+// par lots, exports. Même checksum attendu pour les deux backends, aux arrondis près. Le rejeu
+// d'une copie tronquée de la trace doit s'arrêter sur un message d'erreur.
+int benchmark_trace(const char* filename) {
+    string path = filename ? filename : "workload.trace";
+    if (!filename) {
+#if defined(PIECEWISE_TRACE)
+        const int horizon = 4000;
+        auto f = zigzag_map(horizon, 10, 20, 1);
+        trace::Recorder recorder;
+        {
+            trace::Session session(recorder);
+            vector<map_version::PiecewiseLinearFunction> active;
+            vector<double> xs(256);
+            unsigned int seed = 2024;
+            auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return (seed >> 8); };
+            for (int i = 0; i < 5000; i++) {
+                double a = next() % (horizon - 100) + 0.5;
+                double b = a + 1 + next() % 20;
+                double c = b + 1 + next() % 20;
+                active.push_back(map_version::delta_profile(1 + next() % 5, a, b, c));
+                f.sum(active.back());
+                if (active.size() > 200) {   // la plus ancienne tâche se termine
+                    active.front().scale(-1.0);
+                    f.sum(active.front());
+                    active.erase(active.begin());
+                }
+                for (int q = 0; q < 3; q++) bench::keep(f.evaluate(next() % horizon + 0.25));
+                if (i % 100 == 0) {
+                    for (auto& x : xs) x = next() % horizon + 0.75;
+                    bench::keep(f.evaluate_many(xs));
+                }
+                if (i % 1000 == 999) f.exportFunction("trace_export.csv");
+            }
+        }
+        recorder.save(path);
+        cout << "Trace enregistrée : " << recorder.records() << " enregistrements, " << recorder.data().size()
+             << " octets -> " << path << endl;
+#else
+        cout << "Enregistrement indisponible : recompiler avec -DPIECEWISE_TRACE, ou donner une trace à rejouer"
+             << endl;
+        return 1;
+#endif
+    }
+
+    auto trace_file = trace::Reader::load(path);
+    if (!trace_file.ok()) {
+        cerr << "Erreur: trace illisible " << path << endl;
+        return 1;
+    }
+
+    ofstream out("trace_replay.csv");
+    out << "backend,operation,count,p50_ns,p90_ns,p99_ns,mean_ns,total_us\n";
+    bool complete = true;
+    auto report = [&](const string& backend, trace::Replay r) {
+        if (!r.error.empty()) {
+            cerr << "Erreur: " << backend << " : " << r.error << endl;
+            complete = false;
+        }
+        double total_us = 0.0;
+        for (size_t op = 0; op < trace::OP_COUNT; op++) {
+            auto& lat = r.latency_ns[op];
+            if (lat.empty()) continue;
+            sort(lat.begin(), lat.end());
+            double sum = 0.0;
+            for (double v : lat) sum += v;
+            total_us += sum / 1000.0;
+            out << backend << "," << trace::OP_NAMES[op] << "," << lat.size() << "," << bench::percentile(lat, 0.5)
+                << "," << bench::percentile(lat, 0.9) << "," << bench::percentile(lat, 0.99) << ","
+                << sum / lat.size() << "," << sum / 1000.0 << "\n";
+            cout << backend << " " << trace::OP_NAMES[op] << " x" << lat.size() << " : p50="
+                 << bench::percentile(lat, 0.5) << "ns p90=" << bench::percentile(lat, 0.9) << "ns p99="
+                 << bench::percentile(lat, 0.99) << "ns" << endl;
+        }
+        cout << backend << " : " << r.operations << " opérations, " << (long long)total_us
+             << "us au total, checksum=" << r.checksum << endl;
+    };
+    report("map", trace::replay<map_version::PiecewiseLinearFunction>(trace_file));
+    report("flat", trace::replay<flat_version::PiecewiseLinearFunction>(trace_file));
+
+    // trace privée de son dernier octet : le dernier enregistrement est incomplet
+    {
+        ifstream in(path, ios::binary);
+        vector<uint8_t> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        bytes.pop_back();
+        auto cut = trace::replay<map_version::PiecewiseLinearFunction>(trace::Reader(move(bytes)));
+        cout << "trace tronquée : " << cut.operations << " opérations rejouées, "
+             << (cut.error.empty() ? "aucune erreur détectée" : cut.error) << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers trace_replay.csv" << endl;
+    return complete ? 0 : 1;
+}
+
+// ==================== Benchmark évaluation par lots ====================
+// Boucle d'evaluate contre evaluate_many, requêtes aléatoires puis triées, sur f = zigzag de 4001 points.
+// La boucle scalaire map (parcours linéaire) n'est mesurée que jusqu'à 100k requêtes (-1 au-delà).
+void benchmark_evaluate_many() {
+    ofstream out("evaluate_many_comparison.csv");
+    out << "queries,sorted,map_loop_us,map_batch_us,flat_loop_us,flat_batch_us,list_loop_us,list_batch_us,identical\n";
+
+    const int x_max = 4000;
+    auto f_map = zigzag_map(x_max, 10, 20, 1);
+    auto f_flat = zigzag_flat(x_max, 10, 20, 1);
+    auto f_list = zigzag_list(x_max, 10, 20, 1);
+
+    for (int queries = 1000; queries <= 10000000; queries *= 10) {
+        vector<double> xs(queries);
+        unsigned int seed = 12345;
+        for (auto& x : xs) {
+            seed = seed * 1103515245u + 12345u;
+            x = (seed % (100u * x_max)) / 100.0;
+        }
+
+        for (int sorted = 0; sorted <= 1; sorted++) {
+            if (sorted) sort(xs.begin(), xs.end());
+            vector<double> loop_out(queries), batch_out(queries);
+            bool identical = true;
+
+            auto time_pair = [&](auto& f, bool run_loop, long long& t_loop, long long& t_batch) {
+                t_loop = -1;
+                size_t checked = queries;
+                if (run_loop) {
+                    auto start = high_resolution_clock::now();
+                    for (int k = 0; k < queries; k++) loop_out[k] = f.evaluate(xs[k]);
+                    t_loop = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+                } else {
+                    checked = 1000;
+                    for (size_t k = 0; k < checked; k++) loop_out[k] = f.evaluate(xs[k]);
+                }
+                auto start = high_resolution_clock::now();
+                f.evaluate_many(xs.data(), batch_out.data(), queries);
+                t_batch = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+                identical = identical && equal(loop_out.begin(), loop_out.begin() + checked, batch_out.begin());
+            };
+
+            long long t_map_loop, t_map_batch, t_flat_loop, t_flat_batch, t_list_loop, t_list_batch;
+            time_pair(f_map, queries <= 100000, t_map_loop, t_map_batch);
+            time_pair(f_flat, true, t_flat_loop, t_flat_batch);
+            time_pair(f_list, queries <= 100000, t_list_loop, t_list_batch);
+
+            out << queries << "," << sorted << "," << t_map_loop << "," << t_map_batch << ","
+                << t_flat_loop << "," << t_flat_batch << "," << t_list_loop << "," << t_list_batch << ","
+                << identical << "\n";
+            cout << "queries=" << queries << (sorted ? " sorted" : " random")
+                 << " map " << t_map_loop << "/" << t_map_batch << "us"
+                 << " flat " << t_flat_loop << "/" << t_flat_batch << "us"
+                 << " list " << t_list_loop << "/" << t_list_batch << "us"
+                 << " identical=" << (identical ? "yes" : "NO") << endl;
+        }
+    }
+
+    out.close();
+    cout << "Données exportées vers evaluate_many_comparison.csv" << endl;
+}
+
+// ==================== Benchmark min/max à côté de sum ====================
+// f = zigzag entre 10 et 20, g = zigzag entre 12 et 18 de période 3 ; c = 15 (écrêtage)
+void benchmark_envelope() {
+    ofstream out("envelope_comparison.csv");
+    out << "breakpoints,map_sum_us,map_min_c_us,map_max_c_us,map_min_g_us,map_max_g_us,"
+           "list_add_us,list_min_c_us,list_max_c_us,list_min_g_us,list_max_g_us\n";
+
+    auto time_us = [](auto&& op) {
+        auto start = high_resolution_clock::now();
+        op();
+        return (long long)duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    };
+
+    const double c = 15;
+    for (int x_max = 4000; x_max <= 256000; x_max *= 4) {
+        auto f_map = zigzag_map(x_max, 10, 20, 1);
+        auto g_map = zigzag_map(x_max, 12, 18, 3);
+        auto f_list = zigzag_list(x_max, 10, 20, 1);
+        auto g_list = zigzag_list(x_max, 12, 18, 3);
+
+        long long m[5], l[5];
+        { auto tmp = f_map; m[0] = time_us([&] { tmp.sum(g_map); }); }
+        { auto tmp = f_map; m[1] = time_us([&] { tmp.minfunction(c); }); }
+        { auto tmp = f_map; m[2] = time_us([&] { tmp.maxfunction(c); }); }
+        { auto tmp = f_map; m[3] = time_us([&] { tmp.minfunction(g_map); }); }
+        { auto tmp = f_map; m[4] = time_us([&] { tmp.maxfunction(g_map); }); }
+        { auto tmp = f_list; l[0] = time_us([&] { tmp.add(g_list); }); }
+        l[1] = time_us([&] { auto r = list_version::min_function_with_constant(f_list, c); });
+        l[2] = time_us([&] { auto r = list_version::max_function_with_constant(f_list, c); });
+        l[3] = time_us([&] { auto r = list_version::min_functions(f_list, g_list); });
+        l[4] = time_us([&] { auto r = list_version::max_functions(f_list, g_list); });
+
+        out << f_map.size();
+        for (long long t : m) out << "," << t;
+        for (long long t : l) out << "," << t;
+        out << "\n";
+        cout << "n=" << f_map.size() << " map sum/min c/max c/min g/max g = " << m[0] << "/" << m[1] << "/"
+             << m[2] << "/" << m[3] << "/" << m[4] << "us list = " << l[0] << "/" << l[1] << "/" << l[2]
+             << "/" << l[3] << "/" << l[4] << "us" << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers envelope_comparison.csv" << endl;
+}
+
+// ==================== Benchmark expressions fusionnées ====================
+// net = f1 + f2 - f3 + f4 sur quatre zigzags de périodes différentes : opérations enchaînées
+// (chaque étape matérialise une fonction) contre une expression évaluée en un seul balayage
+void benchmark_expr() {
+    ofstream out("expr_comparison.csv");
+    out << "breakpoints,map_chained_us,map_fused_us,flat_chained_us,flat_fused_us,max_abs_diff\n";
+
+    auto time_us = [](auto&& op) {
+        auto start = high_resolution_clock::now();
+        op();
+        return (long long)duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    };
+
+    for (int x_max = 4000; x_max <= 256000; x_max *= 4) {
+        auto m1 = zigzag_map(x_max, 10, 20, 1), m2 = zigzag_map(x_max, 0, 5, 2);
+        auto m3 = zigzag_map(x_max, 1, 4, 3), m4 = zigzag_map(x_max, 2, 3, 5);
+        auto f1 = zigzag_flat(x_max, 10, 20, 1), f2 = zigzag_flat(x_max, 0, 5, 2);
+        auto f3 = zigzag_flat(x_max, 1, 4, 3), f4 = zigzag_flat(x_max, 2, 3, 5);
+
+        // map_version n'a pas de négation : -m3 passe par une fonction construite à la main
+        map_version::PiecewiseLinearFunction m3_neg;
+        m3_neg.clear();
+        for (const auto& kv : m3) m3_neg.appendBreakpoint(kv.first, -kv.second);
+
+        map_version::PiecewiseLinearFunction map_chained, map_fused;
+        long long t_map_chained = time_us([&] {
+            map_chained = m1;
+            map_chained.sum(m2);
+            map_chained.sum(m3_neg);
+            map_chained.sum(m4);
+        });
+        long long t_map_fused = time_us([&] { map_fused = m1 + m2 - m3 + m4; });
+
+        flat_version::PiecewiseLinearFunction flat_chained, flat_fused;
+        long long t_flat_chained = time_us([&] {
+            flat_chained = f1;
+            flat_chained.sum(f2);
+            flat_chained.sum(flat_version::negate(f3));
+            flat_chained.sum(f4);
+        });
+        long long t_flat_fused = time_us([&] { flat_fused = f1 + f2 - f3 + f4; });
+
+        vector<double> xs;
+        for (double x = 0; x <= x_max; x += 0.5) xs.push_back(x);
+        auto a = map_chained.evaluate_many(xs), b = map_fused.evaluate_many(xs);
+        auto c = flat_chained.evaluate_many(xs), d = flat_fused.evaluate_many(xs);
+        double max_diff = 0.0;
+        for (size_t k = 0; k < xs.size(); k++) {
+            max_diff = max(max_diff, abs(a[k] - b[k]));
+            max_diff = max(max_diff, abs(c[k] - d[k]));
+        }
+
+        out << m1.size() << "," << t_map_chained << "," << t_map_fused << "," << t_flat_chained << ","
+            << t_flat_fused << "," << max_diff << "\n";
+        cout << "n=" << m1.size() << " map chained=" << t_map_chained << "us fused=" << t_map_fused
+             << "us flat chained=" << t_flat_chained << "us fused=" << t_flat_fused
+             << "us diff=" << max_diff << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers expr_comparison.csv" << endl;
+}
+
+// ==================== Benchmark profils de tâche sur la pile ====================
+// Boucle interne de la recherche : créer le profil d'une tâche et l'ajouter à un grand profil.
+// Profil alloué (map / segments) contre SmallPiecewise construit sur la pile.
+void benchmark_small() {
+    ofstream out("small_comparison.csv");
+    out << "breakpoints,tasks,list_tasks,map_create_us,small_create_us,map_sum_us,map_small_sum_us,"
+           "list_add_us,list_small_add_us,same_result\n";
+
+    const int tasks = 2000;
+    const int list_tasks = 200;   // chaque ajout list_version copie tout le profil
+    for (int x_max = 4000; x_max <= 256000; x_max *= 4) {
+        auto f = zigzag_map(x_max, 10, 20, 1);
+        auto l = zigzag_list(x_max, 10, 20, 1);
+
+        vector<double> starts;
+        unsigned int seed = 12345;
+        for (int i = 0; i < tasks; i++) {
+            seed = seed * 1103515245u + 12345u;
+            starts.push_back((seed >> 8) % (x_max - 20) + 0.5);
+        }
+
+        // création seule
+        double sink = 0.0;
+        auto start = high_resolution_clock::now();
+        for (double a : starts) {
+            auto g = map_version::delta_profile(5, a, a + 5, a + 10);
+            sink += g.size();
+        }
+        long long t_map_create = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        start = high_resolution_clock::now();
+        for (double a : starts) {
+            auto g = small_version::delta_profile(5, a, a + 5, a + 10);
+            sink += g.evaluate(a + 5);
+        }
+        long long t_small_create = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        // création + somme + annulation (map_version)
+        bool same = true;
+        start = high_resolution_clock::now();
+        for (double a : starts) {
+            size_t cp = f.checkpoint();
+            f.sum(map_version::delta_profile(5, a, a + 5, a + 10));
+            f.restore(cp);
+        }
+        long long t_map_sum = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        start = high_resolution_clock::now();
+        for (double a : starts) {
+            size_t cp = f.checkpoint();
+            f.sum(small_version::delta_profile(5, a, a + 5, a + 10));
+            f.restore(cp);
+        }
+        long long t_map_small = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+        f.discardTrail();
+
+        // création + ajout sur une copie (list_version n'a pas d'annulation)
+        start = high_resolution_clock::now();
+        for (int i = 0; i < list_tasks; i++) {
+            double a = starts[i];
+            auto tmp = l;
+            tmp.add(list_version::delta_profile_temp(5, a, a + 5, a + 10, x_max));
+            sink += tmp.pool.size();
+        }
+        long long t_list_add = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        start = high_resolution_clock::now();
+        for (int i = 0; i < list_tasks; i++) {
+            double a = starts[i];
+            auto tmp = l;
+            tmp.add(small_version::delta_profile(5, a, a + 5, a + 10));
+            sink += tmp.pool.size();
+        }
+        long long t_list_small = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        // vérification sur quelques tâches : mêmes valeurs qu'avec les profils alloués
+        vector<double> xs;
+        for (double x = 0; x <= x_max; x += 0.25) xs.push_back(x);
+        for (int i = 0; i < 5; i++) {
+            double a = starts[i];
+            auto m1 = f, m2 = f;
+            m1.sum(map_version::delta_profile(5, a, a + 5, a + 10));
+            m2.sum(small_version::delta_profile(5, a, a + 5, a + 10));
+            same = same && (m1.to_points_cumulative() == m2.to_points_cumulative());
+
+            auto l1 = l, l2 = l;
+            l1.add(list_version::delta_profile_temp(5, a, a + 5, a + 10, x_max));
+            l2.add(small_version::delta_profile(5, a, a + 5, a + 10));
+            same = same && (l1.evaluate_many(xs) == l2.evaluate_many(xs));
+        }
+
+        out << f.size() << "," << tasks << "," << list_tasks << "," << t_map_create << "," << t_small_create << ","
+            << t_map_sum << "," << t_map_small << "," << t_list_add << "," << t_list_small << ","
+            << same << "\n";
+        cout << "n=" << f.size() << " create map=" << t_map_create << "us small=" << t_small_create
+             << "us | map sum=" << t_map_sum << "us small=" << t_map_small
+             << "us | list add=" << t_list_add << "us small=" << t_list_small
+             << "us same=" << (same ? "yes" : "NO") << " (" << sink << ")" << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers small_comparison.csv" << endl;
+}
+
+// ==================== Benchmark abscisses entières ====================
+// Instanciation int64_t (comparaisons exactes, sans EPSILON) contre double sur les charges
+// zigzag/delta : construction, somme des deltas de toutes les largeurs, sommes annulées d'une
+// série de tâches (boucle de recherche) et évaluation aux instants entiers
+template<typename X>
+void run_coordinate(int x_max, vector<long long>& times, vector<double>& values) {
+    auto time_us = [](auto&& op) {
+        auto start = high_resolution_clock::now();
+        op();
+        return (long long)duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    };
+
+    map_version::BasicPiecewiseLinearFunction<X> f;
+    times.push_back(time_us([&] { f = zigzag_map<X>(x_max, 10, 20, 1); }));
+
+    map_version::BasicPiecewiseLinearFunction<X> acc;
+    times.push_back(time_us([&] {
+        acc = f;
+        for (int width = 2; width <= x_max; width *= 2) acc.sum(delta_map<X>(x_max, width, 50));
+    }));
+
+    times.push_back(time_us([&] {
+        unsigned int seed = 12345;
+        for (int i = 0; i < 2000; i++) {
+            seed = seed * 1103515245u + 12345u;
+            int a = (seed >> 8) % (x_max - 20);
+            size_t cp = f.checkpoint();
+            f.sum(map_version::delta_profile<X>(5, a, a + 5, a + 10));
+            f.restore(cp);
+        }
+        f.discardTrail();
+    }));
+
+    vector<double> xs;
+    for (int x = 0; x <= x_max; x++) xs.push_back(x);
+    times.push_back(time_us([&] { values = acc.evaluate_many(xs); }));
+
+    acc.enableIndex();
+    double sink = 0.0;
+    times.push_back(time_us([&] {
+        for (int x = 0; x <= x_max; x++) sink += acc.evaluate(static_cast<X>(x));
+    }));
+    values.push_back(sink);
+}
+
+void benchmark_int() {
+    ofstream out("int_comparison.csv");
+    out << "breakpoints,type,build_us,sum_deltas_us,task_sums_us,evaluate_many_us,indexed_eval_us,max_abs_diff\n";
+
+    for (int x_max = 4000; x_max <= 256000; x_max *= 4) {
+        vector<long long> t_double, t_int;
+        vector<double> v_double, v_int;
+        run_coordinate<double>(x_max, t_double, v_double);
+        run_coordinate<int64_t>(x_max, t_int, v_int);
+
+        double max_diff = 0.0;
+        for (size_t k = 0; k < v_double.size(); k++) max_diff = max(max_diff, abs(v_double[k] - v_int[k]));
+
+        const char* names[] = {"double", "int64"};
+        const vector<long long>* times[] = {&t_double, &t_int};
+        for (int t = 0; t < 2; t++) {
+            out << x_max + 1 << "," << names[t];
+            for (long long us : *times[t]) out << "," << us;
+            out << "," << max_diff << "\n";
+            cout << "n=" << x_max + 1 << " " << names[t] << " build=" << (*times[t])[0]
+                 << "us sum_deltas=" << (*times[t])[1] << "us tasks=" << (*times[t])[2]
+                 << "us evaluate_many=" << (*times[t])[3] << "us indexed=" << (*times[t])[4] << "us" << endl;
+        }
+        cout << "   diff double/int64=" << max_diff << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers int_comparison.csv" << endl;
+}
+
+// ==================== Benchmark format binaire projeté ====================
+// Démarrage : reconstruire les profils en mémoire contre ouvrir un lot binaire (mmap) ;
+// puis somme de tous les profils, depuis les maps ou directement depuis les pages projetées
+void benchmark_binary() {
+    ofstream out("binary_comparison.csv");
+    out << "profiles,file_bytes,build_us,write_us,open_us,sum_memory_us,sum_mapped_us,same_result\n";
+
+    const string filename = "profiles.bin";
+    for (int count = 1000; count <= 100000; count *= 10) {
+        auto time_us = [](auto&& op) {
+            auto start = high_resolution_clock::now();
+            op();
+            return (long long)duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+        };
+
+        vector<map_version::PiecewiseLinearFunction> profiles;
+        long long t_build = time_us([&] {
+            profiles.reserve(count);
+            unsigned int seed = 12345;
+            for (int i = 0; i < count; i++) {
+                seed = seed * 1103515245u + 12345u;
+                double a = (seed >> 8) % 100000 + 0.5;
+                profiles.push_back(map_version::delta_profile(1 + seed % 7, a, a + 5, a + 10));
+            }
+        });
+
+        long long t_write = time_us([&] {
+            binary::BundleWriter writer;
+            for (const auto& p : profiles) writer.add(p);
+            writer.save(filename);
+        });
+        long long bytes = (long long)std::filesystem::file_size(filename);
+
+        long long t_open = 0;
+        {
+            auto start = high_resolution_clock::now();
+            binary::Bundle bundle(filename);
+            t_open = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+            // somme d'un sous-ensemble (sum est linéaire dans la taille du résultat)
+            size_t summed = min<size_t>(profiles.size(), 20000);
+            map_version::PiecewiseLinearFunction from_memory, from_mapped;
+            long long t_sum_memory = time_us([&] {
+                for (size_t i = 0; i < summed; i++) from_memory.sum(profiles[i]);
+            });
+            long long t_sum_mapped = time_us([&] {
+                for (size_t i = 0; i < summed; i++) bundle[i].sum_into(from_mapped);
+            });
+            bool same = (from_memory.to_points_cumulative() == from_mapped.to_points_cumulative());
+
+            out << count << "," << bytes << "," << t_build << "," << t_write << "," << t_open << ","
+                << t_sum_memory << "," << t_sum_mapped << "," << same << "\n";
+            cout << "profiles=" << count << " file=" << bytes / 1024 << "KiB build=" << t_build
+                 << "us write=" << t_write << "us open=" << t_open << "us | sum of " << summed
+                 << ": memory=" << t_sum_memory << "us mapped=" << t_sum_mapped
+                 << "us same=" << (same ? "yes" : "NO") << endl;
+        }
+        std::filesystem::remove(filename);
+    }
+
+    out.close();
+    cout << "Données exportées vers binary_comparison.csv" << endl;
+}
+
+// ==================== Benchmark entrées/sorties texte ====================
+// Débit (Mo/s) de l'export/import texte : flux (operator<< / operator>>) contre text::Writer
+// (to_chars) et text::Reader (from_chars), aux formats "x y" (map) et "x,y" (list)
+void benchmark_text() {
+    ofstream out("text_comparison.csv");
+    out << "breakpoints,format,bytes,stream_write_MBps,write_MBps,stream_read_MBps,read_MBps,max_abs_diff\n";
+
+    auto time_us = [](auto&& op) {
+        auto start = high_resolution_clock::now();
+        op();
+        return max<long long>(1, duration_cast<microseconds>(high_resolution_clock::now() - start).count());
+    };
+    const string filename = "profile.txt";
+
+    for (int x_max = 100000; x_max <= 4000000; x_max *= 4) {
+        auto f = zigzag_map(x_max, 10.125, 20.7, 1);
+        auto l = zigzag_list(x_max, 10.125, 20.7, 1);
+        auto points = f.to_points_cumulative();
+
+        for (int format = 0; format < 2; format++) {
+            char sep = (format == 0) ? ' ' : ',';
+
+            // référence : flux C++ (précision par défaut, comme l'ancien export)
+            long long t_stream_write = time_us([&] {
+                ofstream file(filename);
+                if (format == 0) {
+                    for (const auto& p : points) file << p.first << sep << p.second << "\n";
+                } else {
+                    for (uint32_t s = l.head; s != list_version::NIL; s = l.segment(s).next) {
+                        const auto& seg = l.segment(s);
+                        file << seg.x_left << sep << seg.y_left << "\n" << seg.x_right << sep << seg.y_right << "\n";
+                    }
+                }
+            });
+            long long t_write = time_us([&] {
+                if (format == 0) f.exportFunction(filename);
+                else l.export_to_csv(filename);
+            });
+            double bytes = (double)std::filesystem::file_size(filename);
+
+            long long t_stream_read = time_us([&] {
+                ifstream file(filename);
+                map_version::PiecewiseLinearFunction g;
+                g.clear();
+                double x, y, y_prev = 0.0;
+                char c;
+                while (format == 0 ? (bool)(file >> x >> y) : (bool)(file >> x >> c >> y)) {
+                    g.addBreakpoint(x, y - y_prev);
+                    y_prev = y;
+                }
+            });
+
+            double max_diff = 0.0;
+            long long t_read;
+            if (format == 0) {
+                map_version::PiecewiseLinearFunction g;
+                t_read = time_us([&] { g = map_version::importFunction(filename); });
+                auto back = g.to_points_cumulative();
+                if (back.size() != points.size()) max_diff = 1e300;
+                for (size_t k = 0; k < back.size() && k < points.size(); k++) {
+                    max_diff = max(max_diff, abs(back[k].first - points[k].first) + abs(back[k].second - points[k].second));
+                }
+            } else {
+                list_version::PiecewiseLinearFunction g;
+                t_read = time_us([&] { g = list_version::import_from_csv(filename); });
+                uint32_t a = l.head, b = g.head;
+                for (; a != list_version::NIL && b != list_version::NIL; a = l.segment(a).next, b = g.segment(b).next) {
+                    const auto& sa = l.segment(a);
+                    const auto& sb = g.segment(b);
+                    max_diff = max(max_diff, abs(sa.x_left - sb.x_left) + abs(sa.y_left - sb.y_left) +
+                                             abs(sa.x_right - sb.x_right) + abs(sa.y_right - sb.y_right));
+                }
+                if (a != b) max_diff = 1e300;
+            }
+
+            const char* name = (format == 0) ? "map_space" : "list_comma";
+            out << f.size() << "," << name << "," << (long long)bytes << "," << bytes / t_stream_write << ","
+                << bytes / t_write << "," << bytes / t_stream_read << "," << bytes / t_read << "," << max_diff << "\n";
+            cout << "n=" << f.size() << " " << name << " " << (long long)(bytes / 1e6) << "MB write: stream="
+                 << bytes / t_stream_write << "MB/s to_chars=" << bytes / t_write << "MB/s | read: stream="
+                 << bytes / t_stream_read << "MB/s from_chars=" << bytes / t_read << "MB/s diff=" << max_diff << endl;
+        }
+    }
+    std::filesystem::remove(filename);
+
+    out.close();
+    cout << "Données exportées vers text_comparison.csv" << endl;
+}
+
+// ==================== Benchmark compaction / simplification ====================
+// Profil de capacité soumis à des ajouts puis retraits de tâches (sum d'un profil opposé) : nombre
+// de breakpoints et temps, sans compaction, avec compaction automatique dans sum, avec compact()
+// en fin de série ; puis simplify(tolérance) et erreur maximale mesurée sur une grille fine
+void benchmark_compact() {
+    ofstream out("compact_comparison.csv");
+    out << "tasks,method,tolerance,breakpoints,removed,time_us,max_abs_error\n";
+
+    auto time_us = [](auto&& op) {
+        auto start = high_resolution_clock::now();
+        op();
+        return (long long)duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    };
+
+    for (int tasks = 1000; tasks <= 64000; tasks *= 4) {
+        const int horizon = 100000;
+        vector<map_version::PiecewiseLinearFunction> add, remove;
+        unsigned int seed = 12345;
+        for (int i = 0; i < tasks; i++) {
+            seed = seed * 1103515245u + 12345u;
+            double a = (seed >> 8) % (horizon - 20) + 0.5;
+            double gap = 1 + seed % 5;
+            add.push_back(map_version::delta_profile(gap, a, a + 2, a + 4.5));
+            remove.push_back(map_version::delta_profile(-gap, a, a + 2, a + 4.5));
+        }
+
+        // la moitié des tâches est retirée après avoir été ajoutée
+        auto run = [&](map_version::PiecewiseLinearFunction& f) {
+            for (int i = 0; i < tasks; i++) f.sum(add[i]);
+            for (int i = 0; i < tasks; i += 2) f.sum(remove[i]);
+        };
+
+        vector<double> xs;
+        for (double x = 0; x <= horizon; x += 0.125) xs.push_back(x);
+
+        auto plain = map_version::cba_profile(10, 0, 50);
+        long long t_plain = time_us([&] { run(plain); });
+        auto reference = plain.evaluate_many(xs);
+        auto error = [&](const map_version::PiecewiseLinearFunction& g) {
+            auto v = g.evaluate_many(xs);
+            double e = 0.0;
+            for (size_t k = 0; k < xs.size(); k++) e = max(e, abs(v[k] - reference[k]));
+            return e;
+        };
+        auto row = [&](const string& method, double tol, const map_version::PiecewiseLinearFunction& g,
+                       size_t removed, long long t) {
+            double e = error(g);
+            out << tasks << "," << method << "," << tol << "," << g.size() << "," << removed << "," << t << "," << e << "\n";
+            cout << "tasks=" << tasks << " " << method << (tol > 0 ? " tol=" + to_string(tol) : "")
+                 << " : " << g.size() << " points, removed=" << removed << " time=" << t << "us err=" << e << endl;
+        };
+        row("none", 0, plain, 0, t_plain);
+
+        auto automatic = map_version::cba_profile(10, 0, 50);
+        automatic.setAutoCompact(true);
+        long long t_auto = time_us([&] { run(automatic); });
+        row("auto_compact", 0, automatic, automatic.compactedPoints(), t_auto);
+
+        auto once = plain;
+        size_t removed = 0;
+        long long t_once = time_us([&] { removed = once.compact(); });
+        row("compact", 0, once, removed, t_once);
+
+        for (double tol : {0.01, 0.1, 1.0}) {
+            auto simplified = plain;
+            long long t = time_us([&] { removed = simplified.simplify(tol); });
+            row("simplify", tol, simplified, removed, t);
+        }
+    }
+
+    out.close();
+    cout << "Données exportées vers compact_comparison.csv" << endl;
+}
+
+// ==================== Versions persistantes ====================
+// N variantes d'un même profil de base, chacune avec une tâche de plus : copie profonde de la map
+// puis sum, contre snapshot() O(1) puis sum sur la version persistante. La mémoire des copies
+// profondes est estimée (n noeuds de map par copie) : les 1000 copies ne tiennent pas en mémoire
+// pour les grandes bases, elles sont donc chronométrées sur un échantillon puis jetées.
+void benchmark_persistent() {
+    ofstream out("persistent_comparison.csv");
+    out << "base_points,versions,method,time_per_version_us,total_bytes,bytes_per_version,max_abs_error\n";
+
+    const size_t versions = 1000;
+    const size_t copied = 20;   // copies profondes réellement chronométrées
+    const size_t map_node_bytes = 4 * sizeof(void*) + sizeof(pair<const double, double>) + 2 * sizeof(void*);
+
+    for (int x_max : {4000, 64000, 256000}) {
+        auto base = zigzag_map(x_max, 10, 20, 1);
+        vector<map_version::PiecewiseLinearFunction> tasks;
+        unsigned int seed = 777;
+        for (size_t i = 0; i < versions; i++) {
+            seed = seed * 1103515245u + 12345u;
+            double a = (seed >> 8) % (x_max - 10) + 0.25;
+            tasks.push_back(map_version::delta_profile(1 + seed % 5, a, a + 2, a + 4.5));
+        }
+
+        auto start = high_resolution_clock::now();
+        vector<map_version::PiecewiseLinearFunction> deep;
+        for (size_t i = 0; i < copied; i++) {
+            auto f = base;
+            f.sum(tasks[i]);
+            deep.push_back(move(f));
+        }
+        double t_deep = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0 / copied;
+
+        persistent_version::PiecewiseLinearFunction root(base);
+        vector<persistent_version::PiecewiseLinearFunction> shared;
+        shared.reserve(versions);
+        start = high_resolution_clock::now();
+        for (size_t i = 0; i < versions; i++) {
+            auto f = root.snapshot();
+            f.sum(tasks[i]);
+            shared.push_back(move(f));
+        }
+        double t_shared = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0 / versions;
+
+        // les versions persistantes et les copies profondes doivent coïncider
+        vector<double> xs;
+        for (double x = -1; x <= x_max + 1; x += 0.37) xs.push_back(x);
+        double error = 0.0;
+        for (size_t i = 0; i < copied; i++) {
+            auto expected = deep[i].evaluate_many(xs);
+            for (size_t k = 0; k < xs.size(); k += 97) error = max(error, abs(shared[i].evaluate(xs[k]) - expected[k]));
+        }
+
+        size_t deep_bytes = base.size() * map_node_bytes * versions;
+        size_t base_nodes = distinct_nodes(&root, 1);
+        size_t all_nodes = distinct_nodes(shared.data(), shared.size());
+        size_t shared_bytes = all_nodes * persistent_version::PiecewiseLinearFunction::NODE_BYTES;
+        size_t added_bytes = (all_nodes - base_nodes) * persistent_version::PiecewiseLinearFunction::NODE_BYTES;
+
+        out << base.size() << "," << versions << ",deep_copy," << t_deep << "," << deep_bytes << ","
+            << deep_bytes / versions << "," << 0 << "\n";
+        out << base.size() << "," << versions << ",persistent," << t_shared << "," << shared_bytes << ","
+            << added_bytes / versions << "," << error << "\n";
+        cout << "base=" << base.size() << " points, " << versions << " versions : copie profonde " << t_deep
+             << "us/version, ~" << deep_bytes / (1 << 20) << " Mio ; persistant " << t_shared << "us/version, "
+             << shared_bytes / (1 << 20) << " Mio (" << added_bytes / versions << " octets/version, "
+             << all_nodes << " noeuds distincts) err=" << error << endl;
+    }
+
+    // Premier deltaY non nul : base qui commence en 2000 par un saut de 10, tâches qui commencent
+    // autour de ce saut. map_version::sum le relie au point précédent du résultat, la version
+    // persistante le garde : écart attendu sur ce segment seulement.
+    {
+        auto base = zigzag_map(4000, 10, 20, 1);
+        base.shift(2000);
+        base.materialize();
+        persistent_version::PiecewiseLinearFunction root(base);
+        double x0 = base.begin()->first;
+
+        const size_t tasks = 200;
+        double in_ramp = 0.0, outside = 0.0;
+        unsigned int seed = 4242;
+        for (size_t i = 0; i < tasks; i++) {
+            seed = seed * 1103515245u + 12345u;
+            double a = x0 - 10 + (seed >> 8) % 2000 / 100.0;
+            auto task = map_version::delta_profile(1 + seed % 5, a, a + 2, a + 4.5);
+            auto expected = base;
+            expected.sum(task);
+            auto f = root.snapshot();
+            f.sum(task);
+
+            // segment de la map qui remplace le saut : (point précédent, x0)
+            double ramp_lo = x0;
+            for (auto it = expected.begin(); it != expected.end() && it->first < x0; ++it) ramp_lo = it->first;
+            for (double x = x0 - 12; x <= x0 + 30; x += 0.01) {
+                double e = abs(f.evaluate(x) - expected.evaluate(x));
+                if (x > ramp_lo && x < x0) {
+                    in_ramp = max(in_ramp, e);
+                } else {
+                    outside = max(outside, e);
+                }
+            }
+        }
+        out << base.size() << "," << tasks << ",first_jump_outside_ramp,0,0,0," << outside << "\n";
+        out << base.size() << "," << tasks << ",first_jump_in_ramp,0,0,0," << in_ramp << "\n";
+        cout << "premier deltaY non nul (saut de " << base.begin()->second << " en " << x0 << ") : écart à "
+             << "map_version::sum " << outside << " hors du segment qui remplace le saut, " << in_ramp
+             << " sur ce segment" << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers persistent_comparison.csv" << endl;
+}
+
+// ==================== Représentation compressée ====================
+// Profils froids en lecture seule : octets par breakpoint (noeuds de map estimés comme pour
+// benchmark_persistent), débit du parcours décodé à la volée, latence d'evaluate et coût d'un
+// sum dans une map modifiable, contre les backends existants. Profils : zigzag à abscisses
+// entières, somme de tâches à abscisses fractionnaires, zigzag en liste de segments.
+void benchmark_compressed() {
+    using compressed_version::CompressedProfile;
+    ofstream out("compressed_comparison.csv");
+    out << "profile,backend,breakpoints,bytes_per_breakpoint,iterate_mpoints_s,evaluate_ns,sum_into_us,max_abs_diff\n";
+
+    const size_t map_node_bytes = 4 * sizeof(void*) + sizeof(pair<const double, double>) + 2 * sizeof(void*);
+    const int rounds = 20;
+
+    auto ns_since = [](high_resolution_clock::time_point start) {
+        return (double)duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+    };
+    auto row = [&](const string& profile, const string& backend, size_t n, double bytes,
+                   double iterate_ns, double eval_ns, double sum_us, double diff) {
+        double mpts = iterate_ns > 0 ? n * rounds / iterate_ns * 1000.0 : 0.0;
+        out << profile << "," << backend << "," << n << "," << bytes / n << "," << mpts << ","
+            << eval_ns << "," << sum_us << "," << diff << "\n";
+        cout << profile << " " << backend << " : " << n << " points, " << bytes / n << " octets/point, parcours "
+             << mpts << " Mpts/s, evaluate " << eval_ns << "ns";
+        if (sum_us >= 0) cout << ", sum " << sum_us << "us";
+        cout << " diff=" << diff << endl;
+    };
+
+    // profils MAP : zigzag entier et somme de tâches à bords fractionnaires
+    vector<pair<string, map_version::PiecewiseLinearFunction>> maps;
+    maps.emplace_back("zigzag_int", zigzag_map(256000, 10, 20, 1));
+    {
+        auto f = map_version::cba_profile(10, 0, 100000);
+        unsigned int seed = 4242;
+        for (int i = 0; i < 40000; i++) {
+            seed = seed * 1103515245u + 12345u;
+            double a = (seed >> 8) % 9999000 / 100.0 + 0.37;
+            f.sum(map_version::delta_profile(1 + seed % 5, a, a + 1.75, a + 4.2));
+        }
+        maps.emplace_back("tasks_float", move(f));
+    }
+
+    for (auto& entry : maps) {
+        const string& name = entry.first;
+        auto& f = entry.second;
+        size_t n = f.size();
+        double x_max = prev(f.end())->first;
+
+        auto f_idx = f;
+        f_idx.enableIndex();
+        flat_version::PiecewiseLinearFunction flat;
+        flat.clear();
+        flat.reserve(n);
+        for (const auto& p : f.to_points_cumulative()) flat.push_back(p.first, p.second);
+
+        auto start = high_resolution_clock::now();
+        CompressedProfile c(f);
+        double t_build = ns_since(start);
+
+        vector<double> qs(2000);
+        unsigned int seed = 12345;
+        for (double& q : qs) {
+            seed = seed * 1103515245u + 12345u;
+            q = (seed >> 8) % 1000000 * (x_max / 1000000.0);
+        }
+
+        // parcours complet : somme des deltaY pour ne pas laisser le compilateur l'éliminer
+        double acc = 0.0;
+        start = high_resolution_clock::now();
+        for (int r = 0; r < rounds; r++) for (const auto& p : f) acc += p.second;
+        double it_map = ns_since(start);
+        start = high_resolution_clock::now();
+        for (int r = 0; r < rounds; r++) for (double y : flat.values()) acc += y;
+        double it_flat = ns_since(start);
+        start = high_resolution_clock::now();
+        for (int r = 0; r < rounds; r++) for (const auto& p : c) acc += p.second;
+        double it_comp = ns_since(start);
+
+        auto eval_ns = [&](auto& g) {
+            double s = 0.0;
+            auto t0 = high_resolution_clock::now();
+            for (double q : qs) s += g.evaluate(q);
+            acc += s;
+            return ns_since(t0) / qs.size();
+        };
+        double e_map = eval_ns(f), e_idx = eval_ns(f_idx), e_flat = eval_ns(flat), e_comp = eval_ns(c);
+
+        double diff = 0.0;
+        for (double q : qs) diff = max(diff, abs(c.evaluate(q) - f.evaluate(q)));
+
+        // f ajouté à une base modifiable : map.sum(f) contre c.sum_into(map)
+        auto base = map_version::cba_profile(5, 0, x_max);
+        auto r_map = base, r_comp = base;
+        start = high_resolution_clock::now();
+        r_map.sum(f);
+        double s_map = ns_since(start) / 1000.0;
+        start = high_resolution_clock::now();
+        c.sum_into(r_comp);
+        double s_comp = ns_since(start) / 1000.0;
+        double sum_diff = 0.0;
+        for (double q : qs) sum_diff = max(sum_diff, abs(r_map.evaluate(q) - r_comp.evaluate(q)));
+
+        row(name, "map", n, n * map_node_bytes, it_map, e_map, s_map, 0.0);
+        row(name, "map_indexed", n, n * map_node_bytes, -1, e_idx, -1, 0.0);
+        row(name, "flat", n, n * 2 * sizeof(double), it_flat, e_flat, -1, 0.0);
+        row(name, "compressed", n, c.bytes(), it_comp, e_comp, s_comp, max(diff, sum_diff));
+        cout << "  (compression " << t_build / 1000.0 << "us, abscisses "
+             << (c.integralAbscissas() ? "entières" : "XOR") << ", checksum " << acc << ")" << endl;
+    }
+
+    // profil LIST : zigzag de segments contigus
+    {
+        auto l = zigzag_list(256000, 10, 20, 1);
+        size_t n = 0;
+        for (uint32_t i = l.head; i != list_version::NIL; i = l.segment(i).next) n++;
+
+        auto start = high_resolution_clock::now();
+        CompressedProfile c(l);
+        double t_build = ns_since(start);
+
+        vector<double> qs(2000);
+        unsigned int seed = 12345;
+        for (double& q : qs) {
+            seed = seed * 1103515245u + 12345u;
+            q = (seed >> 8) % 25600000 / 100.0;
+        }
+
+        double acc = 0.0;
+        start = high_resolution_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            for (uint32_t i = l.head; i != list_version::NIL; i = l.segment(i).next) acc += l.segment(i).y_right;
+        }
+        double it_list = ns_since(start);
+        start = high_resolution_clock::now();
+        for (int r = 0; r < rounds; r++) c.forEachSegment([&](const list_version::Segment& seg) { acc += seg.y_right; });
+        double it_comp = ns_since(start);
+
+        auto eval_ns = [&](auto& g) {
+            double s = 0.0;
+            auto t0 = high_resolution_clock::now();
+            for (double q : qs) s += g.evaluate(q);
+            acc += s;
+            return ns_since(t0) / qs.size();
+        };
+        double e_list = eval_ns(l), e_comp = eval_ns(c);
+        double diff = 0.0;
+        for (double q : qs) diff = max(diff, abs(c.evaluate(q) - l.evaluate(q)));
+
+        row("zigzag_list", "list", n, n * sizeof(list_version::Segment), it_list, e_list, -1, 0.0);
+        row("zigzag_list", "compressed", n, c.bytes(), it_comp, e_comp, -1, diff);
+        cout << "  (compression " << t_build / 1000.0 << "us, checksum " << acc << ")" << endl;
+    }
+
+    out.close();
+    cout << "Données exportées vers compressed_comparison.csv" << endl;
+}
+
+// ==================== Suite de benchmarks ====================
+// Matrice backend x taille x opération (sum/add, evaluate, evaluate_many, export) mesurée par
+// bench::measure ; la copie du profil modifié est préparée hors chronométrage.
+// Résultats dans bench_results.csv ; avec un argument, comparaison à ce CSV de référence.
+int benchmark_suite(const string& baseline) {
+    bench::Suite suite;
+    const string export_file = "bench_export.txt";
+
+    for (int size : {1000, 16000, 256000}) {
+        int x_max = size - 1;
+        int width = max(10, size / 10);
+        string param = "width=" + to_string(width);
+
+        vector<double> queries(1024);
+        unsigned int seed = 12345;
+        for (double& q : queries) {
+            seed = seed * 1103515245u + 12345u;
+            q = (seed >> 8) % (x_max * 100) / 100.0;
+        }
+        vector<double> results(queries.size());
+        double mid = x_max / 2 + 0.25;
+
+        {
+            auto f = zigzag_map(x_max, 10, 20, 1);
+            auto g = delta_map(x_max, width, 50);
+            suite.add("map", "sum", f.size(), param,
+                      bench::measure([&] { return f; }, [&](auto& tmp) { tmp.sum(g); }));
+            suite.add("map", "evaluate", f.size(), "",
+                      bench::measure([] { return 0; }, [&](int&) { bench::keep(f.evaluate(mid)); }));
+            suite.add("map", "evaluate_many", f.size(), "queries=1024",
+                      bench::measure([] { return 0; }, [&](int&) {
+                          f.evaluate_many(queries.data(), results.data(), queries.size());
+                          bench::keep(results[0]);
+                      }));
+            suite.add("map", "export", f.size(), "",
+                      bench::measure([] { return 0; }, [&](int&) { f.exportFunction(export_file); }));
+        }
+        {
+            auto f = zigzag_list(x_max, 10, 20, 1);
+            auto g = delta_list(x_max, width, 50);
+            size_t n = f.pool.size();
+            suite.add("list", "add", n, param,
+                      bench::measure([&] { return f; }, [&](auto& tmp) { tmp.add(g); }));
+            suite.add("list", "evaluate", n, "",
+                      bench::measure([] { return 0; }, [&](int&) { bench::keep(f.evaluate(mid)); }));
+            suite.add("list", "evaluate_many", n, "queries=1024",
+                      bench::measure([] { return 0; }, [&](int&) {
+                          f.evaluate_many(queries.data(), results.data(), queries.size());
+                          bench::keep(results[0]);
+                      }));
+            suite.add("list", "export", n, "",
+                      bench::measure([] { return 0; }, [&](int&) { f.export_to_csv(export_file); }));
+        }
+        {
+            auto f = zigzag_flat(x_max, 10, 20, 1);
+            auto g = delta_flat(x_max, width, 50);
+            suite.add("flat", "sum", f.size(), param,
+                      bench::measure([&] { return f; }, [&](auto& tmp) { tmp.sum(g); }));
+            suite.add("flat", "evaluate", f.size(), "",
+                      bench::measure([] { return 0; }, [&](int&) { bench::keep(f.evaluate(mid)); }));
+            suite.add("flat", "evaluate_many", f.size(), "queries=1024",
+                      bench::measure([] { return 0; }, [&](int&) {
+                          f.evaluate_many(queries.data(), results.data(), queries.size());
+                          bench::keep(results[0]);
+                      }));
+            suite.add("flat", "export", f.size(), "",
+                      bench::measure([] { return 0; }, [&](int&) { f.exportFunction(export_file); }));
+        }
     }
-    return total / repeat;
+    std::filesystem::remove(export_file);
+
+    suite.write_csv("bench_results.csv");
+    cout << "Données exportées vers bench_results.csv" << endl;
+
+    if (baseline.empty()) return 0;
+    size_t regressions = suite.compare(baseline);
+    cout << regressions << " régression(s) par rapport à " << baseline << endl;
+    return regressions > 0 ? 1 : 0;
 }
 
-int main() {
+int main(int argc, char** argv) {
+
+    if (argc > 1 && string(argv[1]) == "eval") {
+        benchmark_eval();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "range") {
+        benchmark_range();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "placement") {
+        benchmark_placement();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "multi") {
+        benchmark_multi();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "affine") {
+        benchmark_affine();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "concurrent") {
+        benchmark_concurrent();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "batch") {
+        benchmark_batch();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "undo") {
+        benchmark_undo();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "parallel") {
+        benchmark_parallel();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "segsum") {
+        benchmark_segmented_sum();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "trace") {
+        return benchmark_trace(argc > 2 ? argv[2] : nullptr);
+    }
+    if (argc > 1 && string(argv[1]) == "evalmany") {
+        benchmark_evaluate_many();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "envelope") {
+        benchmark_envelope();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "expr") {
+        benchmark_expr();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "small") {
+        benchmark_small();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "int") {
+        benchmark_int();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "binary") {
+        benchmark_binary();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "text") {
+        benchmark_text();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "compact") {
+        benchmark_compact();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "persistent") {
+        benchmark_persistent();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "compressed") {
+        benchmark_compressed();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "suite") {
+        return benchmark_suite(argc > 2 ? argv[2] : "");
+    }
 
     namespace fs = std::filesystem;
     fs::create_directory("csv_data");  // crée le dossier si nécessaire
@@ -142,13 +2016,31 @@ int main() {
     auto f_map = zigzag_map(x_max, y_min, y_max, period);
         f_map.exportFunction("csv_data/f.csv");
     auto f_list = zigzag_list(x_max, y_min, y_max, period);
+    auto f_flat = zigzag_flat(x_max, y_min, y_max, period);
+
+    // copie indexée de f pour compter les breakpoints de la fenêtre en O(log n) ; f_map reste non
+    // indexé pour ne pas changer le coût mesuré de sum
+    auto f_query = f_map;
+    f_query.enableIndex();
+
+    // médianes (et p90) en microsecondes, copie de f hors chronométrage ; avec -DPIECEWISE_COUNTERS,
+    // colonnes de coût d'un sum/add en plus
+    bench::Options sweep;
+    sweep.warmup = 1;
+    sweep.min_samples = 5;
+    sweep.budget_ns = 1e7;
 
     ofstream out("timing_comparison.csv");
-    out << "width,time_map_us,time_list_us,nodes_in_g\n";
+    out << "width,time_map_us,time_list_us,time_flat_us,nodes_in_g,p90_map_us,p90_list_us,p90_flat_us";
+    if (counters::ENABLED) {
+        out << ",map_merge_steps,map_lookups,map_node_allocs,list_add_steps,list_segment_allocs";
+    }
+    out << "\n";
 
     for (int width = 10; width <= delta_max_width; width += 10) {
         auto g_map = delta_map(x_max, width, amplitude);
         auto g_list = delta_list(x_max, width, amplitude);
+        auto g_flat = delta_flat(x_max, width, amplitude);
 
         g_map.exportFunction("csv_data/f_plus_g_" + std::to_string(width) + ".csv");
 
@@ -156,29 +2048,43 @@ int main() {
 
         int left = mid - width / 2;
         int right = mid + width / 2;
-        auto points = f_map.to_points_cumulative();
-        int nodes_in_g = 0;
-        for (auto& p : points) if (p.first >= left && p.first <= right) nodes_in_g++;
+        size_t nodes_in_g = f_query.countBreakpoints(left, right);
 
         // Benchmark map
-        long long t_map = benchmark([&]() {
-            auto tmp = f_map;
-            tmp.sum(g_map);
-        });
+        auto r_map = bench::measure([&] { return f_map; }, [&](auto& tmp) { tmp.sum(g_map); }, sweep);
 
         // Benchmark list
-        long long t_list = benchmark([&]() {
-            auto tmp = f_list;
-            tmp.add(g_list);
-        });
+        auto r_list = bench::measure([&] { return f_list; }, [&](auto& tmp) { tmp.add(g_list); }, sweep);
+
+        // Benchmark flat
+        auto r_flat = bench::measure([&] { return f_flat; }, [&](auto& tmp) { tmp.sum(g_flat); }, sweep);
+
+        double t_map = r_map.median_ns / 1000.0;
+        double t_list = r_list.median_ns / 1000.0;
+        double t_flat = r_flat.median_ns / 1000.0;
 
-        out << width << "," << t_map << "," << t_list << "," << nodes_in_g << "\n";
-        cout << "Width=" << width << " map=" << t_map << " list=" << t_list
+        out << width << "," << t_map << "," << t_list << "," << t_flat << "," << nodes_in_g << ","
+            << r_map.p90_ns / 1000.0 << "," << r_list.p90_ns / 1000.0 << "," << r_flat.p90_ns / 1000.0;
+        if (counters::ENABLED) {
+            const char* const* names = counters::NAMES;
+            auto column = [&](const bench::Result& r, const char* name) {
+                for (size_t k = 0; k < counters::Counters::COUNT; k++) {
+                    if (string(names[k]) == name) return r.counters[k];
+                }
+                return uint64_t(0);
+            };
+            out << "," << column(r_map, "sum_merge_steps") << "," << column(r_map, "map_lookups") << ","
+                << column(r_map, "map_node_allocs") << "," << column(r_list, "add_functions_steps") << ","
+                << column(r_list, "segment_pool_growth");
+        }
+        out << "\n";
+        cout << "Width=" << width << " map=" << t_map << " list=" << t_list << " flat=" << t_flat
              << " nodes_in_g=" << nodes_in_g << endl;
              cout << "left = " << left << " right =  " << right  << endl;
     }
 
     out.close();
+    cout << "Fonctions exportées dans csv_data/" << endl;
     cout << "Données exportées vers timing_comparison.csv" << endl;
     return 0;
 }
@@ -5,12 +5,22 @@
 #include <string>
 #include <fstream>
 #include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "piecewise_simd.hpp"
+#include "piecewise_small.hpp"
+#include "piecewise_text.hpp"
+#include "piecewise_counters.hpp"
 namespace list_version {
 
+// Indice d'un segment dans le pool de sa fonction (NIL = pas de segment)
+const uint32_t NIL = UINT32_MAX;
+
 struct Segment {
     double x_left, y_left;
     double x_right, y_right;
-    std::shared_ptr<Segment> next = nullptr;
+    uint32_t next = NIL;
 
     Segment(double xl, double yl, double xr, double yr)
         : x_left(xl), y_left(yl), x_right(xr), y_right(yr) {}
@@ -25,53 +35,184 @@ struct Segment {
     }
 };
 
+// Liste chaînée de segments stockée dans un pool propre à la fonction : les liens sont des indices
+// 32 bits, le pointeur de queue rend l'ajout en O(1) et les segments libérés sont recyclés.
 class PiecewiseLinearFunction {
 public:
-    std::shared_ptr<Segment> head = nullptr;
+    std::vector<Segment> pool;
+    uint32_t head = NIL;
+    uint32_t tail = NIL;
+    uint32_t free_head = NIL;   // liste des segments libérés (chaînés par next)
+
+    Segment& segment(uint32_t i) { return pool[i]; }
+    const Segment& segment(uint32_t i) const { return pool[i]; }
 
-    void add_segment(std::shared_ptr<Segment> seg) {
-        if (!head) {
-            head = seg;
+    void reserve(size_t n) { pool.reserve(n); }
+
+    void clear() {
+        pool.clear();
+        head = tail = free_head = NIL;
+    }
+
+    void add_segment(const Segment& seg) {
+        PWL_COUNT(add_segment_calls, 1);
+        uint32_t i;
+        if (free_head != NIL) {
+            i = free_head;
+            free_head = pool[i].next;
+            pool[i] = seg;
         } else {
-            auto current = head;
-            while (current->next) current = current->next;
-            current->next = seg;
+            i = static_cast<uint32_t>(pool.size());
+            pool.push_back(seg);
+            PWL_COUNT(segment_pool_growth, 1);
         }
+        pool[i].next = NIL;
+
+        if (head == NIL) {
+            head = i;
+        } else {
+            pool[tail].next = i;
+        }
+        tail = i;
+    }
+
+    void add_segment(double xl, double yl, double xr, double yr) {
+        add_segment(Segment(xl, yl, xr, yr));
     }
 
+    // Valeur en x sur le premier segment qui contient x (0 hors des segments)
+    double evaluate(double x) const {
+        for (uint32_t current = head; current != NIL; current = pool[current].next) {
+            const Segment& seg = pool[current];
+            if (x <= seg.x_right) {
+                return (x < seg.x_left) ? 0.0 : seg.evaluate(x);
+            }
+        }
+        return 0.0;
+    }
+
+    // Évalue la fonction en count points : out[k] = evaluate(xs[k]), résultats identiques bit à bit.
+    // Les segments sont mis à plat une fois avec leurs pentes, au lieu d'un get_slope par appel.
+    void evaluate_many(const double* xs, double* out, size_t count) const {
+        std::vector<double> xl, yl, xr, slope;
+        xl.reserve(pool.size());
+        yl.reserve(pool.size());
+        xr.reserve(pool.size());
+        slope.reserve(pool.size());
+        for (uint32_t current = head; current != NIL; current = pool[current].next) {
+            const Segment& seg = pool[current];
+            xl.push_back(seg.x_left);
+            yl.push_back(seg.y_left);
+            xr.push_back(seg.x_right);
+            slope.push_back(seg.get_slope());
+        }
+        simd::segments_many(xl.data(), yl.data(), xr.data(), slope.data(), xl.size(), xs, out, count);
+    }
+
+    std::vector<double> evaluate_many(const std::vector<double>& xs) const {
+        std::vector<double> out(xs.size());
+        evaluate_many(xs.data(), out.data(), xs.size());
+        return out;
+    }
+
+    // Deux lignes "x,y" par segment (extrémités gauche puis droite), relues par import_from_csv
     void export_to_csv(const std::string& filename) const {
-        std::ofstream file(filename);
-        auto current = head;
-        while (current) {
-            file << current->x_left << "," << current->y_left << "\n";
-            file << current->x_right << "," << current->y_right << "\n";
-            current = current->next;
+        text::Writer file(filename);
+        uint32_t current = head;
+        while (current != NIL) {
+            const Segment& seg = pool[current];
+            file.point(seg.x_left, seg.y_left, ',');
+            file.point(seg.x_right, seg.y_right, ',');
+            current = seg.next;
         }
         file.close();
     }
 
     void simplify() {
-        if (!head || !head->next) return;
-
-        auto current = head;
-        while (current->next) {
-            auto next = current->next;
-            double slope1 = current->get_slope();
-            double slope2 = next->get_slope();
-
-            if (std::abs(slope1 - slope2) < 1e-9 && std::abs(current->y_right - next->y_left) < 1e-9) {
-                // Fusion
-                current->x_right = next->x_right;
-                current->y_right = next->y_right;
-                current->next = next->next;
+        PWL_COUNT(simplify_calls, 1);
+        if (head == NIL || pool[head].next == NIL) return;
+
+        uint32_t current = head;
+        while (pool[current].next != NIL) {
+            PWL_COUNT(simplify_visited, 1);
+            Segment& cur = pool[current];
+            uint32_t next_id = cur.next;
+            const Segment& next = pool[next_id];
+            double slope1 = cur.get_slope();
+            double slope2 = next.get_slope();
+
+            if (std::abs(slope1 - slope2) < 1e-9 && std::abs(cur.y_right - next.y_left) < 1e-9) {
+                // Fusion, le segment absorbé retourne dans la liste libre
+                PWL_COUNT(simplify_merged, 1);
+                cur.x_right = next.x_right;
+                cur.y_right = next.y_right;
+                cur.next = next.next;
+                if (tail == next_id) tail = current;
+                pool[next_id].next = free_head;
+                free_head = next_id;
             } else {
-                current = current->next;
+                current = cur.next;
             }
         }
     }
 
     void add(const PiecewiseLinearFunction& other) ;
 
+    // Ajout en place d'un profil de tâche sur la pile (0 avant son premier point, constant après
+    // le dernier) : seuls les segments de sa fenêtre sont coupés aux breakpoints de g puis relevés,
+    // les nouveaux segments venant de la liste libre. Sur le domaine de f, même résultat que
+    // add(delta_profile_temp(...)) sans construire ni fusionner une seconde liste.
+    template<size_t N>
+    void add(const small_version::SmallPiecewise<N>& g) {
+        if (g.count == 0) return;
+        double x_first = g.points[0].first;
+        double x_last = g.points[g.count - 1].first;
+        bool flat_after = (g.valueAt(g.count - 1) == 0.0);
+
+        size_t k = 0;   // premier point de g au-delà du début du segment courant
+        for (uint32_t current = head; current != NIL; current = pool[current].next) {
+            if (pool[current].x_right <= x_first) continue;
+            if (flat_after && pool[current].x_left >= x_last) break;
+
+            while (k < g.count && g.points[k].first <= pool[current].x_left) ++k;
+            for (; k < g.count && g.points[k].first < pool[current].x_right; ++k) {
+                uint32_t right = split(current, g.points[k].first);
+                shift(current, g);
+                current = right;
+            }
+            shift(current, g);
+        }
+    }
+
+private:
+    // Coupe le segment i en x (x_left < x < x_right), renvoie l'indice de la moitié droite
+    uint32_t split(uint32_t i, double x) {
+        Segment right(x, pool[i].evaluate(x), pool[i].x_right, pool[i].y_right);
+        right.next = pool[i].next;
+        uint32_t j;
+        if (free_head != NIL) {
+            j = free_head;
+            free_head = pool[j].next;
+            pool[j] = right;
+        } else {
+            j = static_cast<uint32_t>(pool.size());
+            pool.push_back(right);
+            PWL_COUNT(segment_pool_growth, 1);
+        }
+        pool[i].x_right = x;
+        pool[i].y_right = right.y_left;
+        pool[i].next = j;
+        if (tail == i) tail = j;
+        return j;
+    }
+
+    // Ajoute g aux extrémités du segment i (limite à gauche de g à droite du segment)
+    template<size_t N>
+    void shift(uint32_t i, const small_version::SmallPiecewise<N>& g) {
+        pool[i].y_left += g.evaluate(pool[i].x_left);
+        pool[i].y_right += g.leftLimit(pool[i].x_right);
+    }
+
 };
 
 
@@ -84,14 +225,11 @@ public:
 PiecewiseLinearFunction delta_profile_temp(double gap, double a, double b , double c, double horizon ){
 
     PiecewiseLinearFunction delta;
-    auto seg1 = std::make_shared<Segment>(0, 0.0, a, 0.0);
-    auto seg2 = std::make_shared<Segment>(a, 0.0, b, gap);
-    auto seg3 = std::make_shared<Segment>(b, gap, c, 0.0);
-    auto seg4 = std::make_shared<Segment>(c, 0.0, horizon, 0.0);
-    delta.add_segment(seg1);
-    delta.add_segment(seg2);
-    delta.add_segment(seg3);
-    delta.add_segment(seg4);
+    delta.reserve(4);
+    delta.add_segment(0, 0.0, a, 0.0);
+    delta.add_segment(a, 0.0, b, gap);
+    delta.add_segment(b, gap, c, 0.0);
+    delta.add_segment(c, 0.0, horizon, 0.0);
 
     return delta ;
 
@@ -101,53 +239,82 @@ PiecewiseLinearFunction cba_profile(double cap, double a, double b, double horiz
 
     PiecewiseLinearFunction cba;
 
-            auto seg1= std::make_shared<Segment>(0, 0, a, 0);
-            auto seg2 = std::make_shared<Segment>(a, 0 , b , cap);
-            auto seg3 = std::make_shared<Segment>(b, cap, horizon, cap);
-            cba.add_segment(seg1);
-            cba.add_segment(seg2);
-            cba.add_segment(seg3);  
+            cba.reserve(3);
+            cba.add_segment(0, 0, a, 0);
+            cba.add_segment(a, 0 , b , cap);
+            cba.add_segment(b, cap, horizon, cap);
 
     return cba;
 }
 
+// Relecture d'un fichier écrit par export_to_csv : deux lignes (gauche, droite) par segment
+PiecewiseLinearFunction import_from_csv(const std::string& filename) {
+    text::Reader in(filename);
+    PiecewiseLinearFunction f;
+    f.reserve(in.bytes() / 32);
+
+    double xl, yl, xr, yr;
+    while (in.next(xl, yl)) {
+        if (!in.next(xr, yr)) {
+            throw std::runtime_error(filename + " : nombre impair de points, segment incomplet");
+        }
+        f.add_segment(xl, yl, xr, yr);
+    }
+    return f;
+}
+
 //=====================================================================================================================
 //=====================================================================================================================
 //============================================ Elementary operation (sum, min max...)==================================
 //=====================================================================================================================
 
-PiecewiseLinearFunction add_functions(const PiecewiseLinearFunction& f1, const PiecewiseLinearFunction& f2) {
-    PiecewiseLinearFunction result;
-    auto a = f1.head;
-    auto b = f2.head;
-
-    while (a && b) {
-        double start = std::max(a->x_left, b->x_left);
-        double end = std::min(a->x_right, b->x_right);
+// Écrit f1 + f2 dans result (vidé au préalable), sans allocation par segment
+void add_functions_into(const PiecewiseLinearFunction& f1, const PiecewiseLinearFunction& f2,
+                        PiecewiseLinearFunction& result) {
+    PWL_COUNT(add_functions_calls, 1);
+    result.clear();
+    result.reserve(f1.pool.size() + f2.pool.size());
+    uint32_t a = f1.head;
+    uint32_t b = f2.head;
+
+    while (a != NIL && b != NIL) {
+        PWL_COUNT(add_functions_steps, 1);
+        const Segment& sa = f1.segment(a);
+        const Segment& sb = f2.segment(b);
+        double start = std::max(sa.x_left, sb.x_left);
+        double end = std::min(sa.x_right, sb.x_right);
 
         if (start > end) {
-            if (a->x_right < b->x_right) a = a->next;
-            else b = b->next;
+            if (sa.x_right < sb.x_right) a = sa.next;
+            else b = sb.next;
             continue;
         }
 
-        double y1_start = a->evaluate(start);
-        double y1_end = a->evaluate(end);
-        double y2_start = b->evaluate(start);
-        double y2_end = b->evaluate(end);
+        double y1_start = sa.evaluate(start);
+        double y1_end = sa.evaluate(end);
+        double y2_start = sb.evaluate(start);
+        double y2_end = sb.evaluate(end);
 
-        auto seg = std::make_shared<Segment>(start, y1_start + y2_start, end, y1_end + y2_end);
-        result.add_segment(seg);
+        result.add_segment(start, y1_start + y2_start, end, y1_end + y2_end);
 
-        if (a->x_right <= end) a = a->next;
-        if (b->x_right <= end) b = b->next;
+        if (sa.x_right <= end) a = sa.next;
+        if (sb.x_right <= end) b = sb.next;
     }
+}
+
+PiecewiseLinearFunction add_functions(const PiecewiseLinearFunction& f1, const PiecewiseLinearFunction& f2) {
+    PiecewiseLinearFunction result;
+    add_functions_into(f1, f2, result);
     return result;
 }
 
 void PiecewiseLinearFunction::add(const PiecewiseLinearFunction& other) {
-    PiecewiseLinearFunction sum = add_functions(*this, other);
+    PiecewiseLinearFunction sum;
+    add_functions_into(*this, other, sum);
+    pool.swap(sum.pool);
     head = sum.head;
+    tail = sum.tail;
+    free_head = NIL;
 }
 
 
@@ -155,250 +322,206 @@ void PiecewiseLinearFunction::add(const PiecewiseLinearFunction& other) {
 
 
 
+// Somme de N fonctions en une passe : chaque segment ouvre (+y_left, +pente) en x_left et ferme
+// (-y_right, -pente) en x_right ; un tri global puis un balayage produisent tous les segments.
+// Comme add_functions, le résultat est restreint à l'intersection des domaines.
+PiecewiseLinearFunction add_all(const PiecewiseLinearFunction* functions, size_t count) {
+    PiecewiseLinearFunction result;
+    if (count == 0) return result;
+
+    struct Event {
+        double x, dvalue, dslope;
+        int dopen;
+    };
+
+    double lo = -INFINITY, hi = INFINITY;
+    size_t total = 0;
+    for (size_t k = 0; k < count; ++k) {
+        const PiecewiseLinearFunction& f = functions[k];
+        if (f.head == NIL) return result;
+        lo = std::max(lo, f.segment(f.head).x_left);
+        hi = std::min(hi, f.segment(f.tail).x_right);
+        total += 2 * f.pool.size();
+    }
+    if (lo > hi) return result;
+
+    std::vector<Event> events;
+    events.reserve(total);
+    for (size_t k = 0; k < count; ++k) {
+        const PiecewiseLinearFunction& f = functions[k];
+        for (uint32_t s = f.head; s != NIL; s = f.segment(s).next) {
+            const Segment& seg = f.segment(s);
+            if (seg.x_right <= seg.x_left) continue;   // segment dégénéré
+            double slope = seg.get_slope();
+            events.push_back({seg.x_left, seg.y_left, slope, 1});
+            events.push_back({seg.x_right, -seg.y_right, -slope, -1});
+        }
+    }
+
+    std::sort(events.begin(), events.end(),
+              [](const Event& a, const Event& b) { return a.x < b.x; });
+
+    result.reserve(events.size() / 2 + 1);
+    double value = 0.0;    // valeur à droite du dernier x traité
+    double slope = 0.0;
+    double x_prev = 0.0;
+    int open = 0;
+    size_t i = 0;
+    while (i < events.size()) {
+        double x = events[i].x;
+        double left_value = value + slope * (x - x_prev);   // limite à gauche en x
+
+        if (i > 0 && x_prev >= lo && x <= hi && x > x_prev) {
+            result.add_segment(x_prev, value, x, left_value);
+        }
+
+        double dslope = 0.0;
+        value = left_value;
+        while (i < events.size() && events[i].x == x) {
+            value += events[i].dvalue;
+            dslope += events[i].dslope;
+            open += events[i].dopen;
+            ++i;
+        }
+
+        // plus aucun segment ouvert : valeur et pente exactement nulles
+        if (open == 0) {
+            value = 0.0;
+            slope = 0.0;
+        } else {
+            slope += dslope;
+        }
+        x_prev = x;
+    }
+
+    return result;
+}
+
+PiecewiseLinearFunction add_all(const std::vector<PiecewiseLinearFunction>& functions) {
+    return add_all(functions.data(), functions.size());
+}
+
 PiecewiseLinearFunction negate(const PiecewiseLinearFunction& f) {
     PiecewiseLinearFunction result;
-    auto current = f.head;
-    while (current) {
-        result.add_segment(std::make_shared<Segment>(
-            current->x_left, -current->y_left,
-            current->x_right, -current->y_right
-        ));
-        current = current->next;
+    result.reserve(f.pool.size());
+    uint32_t current = f.head;
+    while (current != NIL) {
+        const Segment& seg = f.segment(current);
+        result.add_segment(
+            seg.x_left, -seg.y_left,
+            seg.x_right, -seg.y_right
+        );
+        current = seg.next;
     }
     return result;
 }
 
-// PiecewiseLinearFunction min_functions(const PiecewiseLinearFunction& f1, const PiecewiseLinearFunction& f2) {
-//     PiecewiseLinearFunction result;
-//     auto a = f1.head;
-//     auto b = f2.head;
-
-//     while (a && b) {
-//         double start = std::max(a->x_left, b->x_left);
-//         double end = std::min(a->x_right, b->x_right);
-
-//         if (start > end) {
-//             if (a->x_right < b->x_right) a = a->next;
-//             else b = b->next;
-//             continue;
-//         }
-
-//         double fa_start = a->evaluate(start);
-//         double fa_end = a->evaluate(end);
-//         double fb_start = b->evaluate(start);
-//         double fb_end = b->evaluate(end);
-
-//         bool intersect = (fa_start - fb_start) * (fa_end - fb_end) < 0;
-
-//         if (!intersect) {
-//             auto chosen = ((fa_start <= fb_start) && (fa_end <= fb_end)) ? a : b;
-//             result.add_segment(std::make_shared<Segment>(
-//                 start, chosen->evaluate(start),
-//                 end, chosen->evaluate(end)
-//             ));
-//         }
-//         else {
-//             double m1 = a->get_slope();
-//             double m2 = b->get_slope();
-//             double c1 = a->y_left - m1 * a->x_left;
-//             double c2 = b->y_left - m2 * b->x_left;
-//             double x_star = (c2 - c1) / (m1 - m2);
-
-//             auto chosen1 = (a->evaluate((start + x_star) / 2.0) < b->evaluate((start + x_star) / 2.0)) ? a : b;
-//             result.add_segment(std::make_shared<Segment>(
-//                 start, chosen1->evaluate(start),
-//                 x_star, chosen1->evaluate(x_star)
-//             ));
-
-//             auto chosen2 = (a->evaluate((x_star + end) / 2.0) < b->evaluate((x_star + end) / 2.0)) ? a : b;
-//             result.add_segment(std::make_shared<Segment>(
-//                 x_star, chosen2->evaluate(x_star),
-//                 end, chosen2->evaluate(end)
-//             ));
-//         }
-
-//         if (a->x_right <= end) a = a->next;
-//         if (b->x_right <= end) b = b->next;
-//     }
-//     result.simplify();
-//     return result;
-// }
-
-// PiecewiseLinearFunction max_functions(const PiecewiseLinearFunction& f1, const PiecewiseLinearFunction& f2) {
-//     PiecewiseLinearFunction result;
-//     auto a = f1.head;
-//     auto b = f2.head;
-
-//     while (a && b) {
-//         double start = std::max(a->x_left, b->x_left);
-//         double end = std::min(a->x_right, b->x_right);
-
-//         if (start > end) {
-//             if (a->x_right < b->x_right) a = a->next;
-//             else b = b->next;
-//             continue;
-//         }
-
-//         double fa_start = a->evaluate(start);
-//         double fa_end = a->evaluate(end);
-//         double fb_start = b->evaluate(start);
-//         double fb_end = b->evaluate(end);
-
-//         bool intersect = (fa_start - fb_start) * (fa_end - fb_end) < 0;
-
-//         if (!intersect) {
-//             auto chosen = ((fa_start >= fb_start) && (fa_end >= fb_end)) ? a : b;
-//             result.add_segment(std::make_shared<Segment>(
-//                 start, chosen->evaluate(start),
-//                 end, chosen->evaluate(end)
-//             ));
-//         } else {
-//             double m1 = a->get_slope();
-//             double m2 = b->get_slope();
-//             double c1 = a->y_left - m1 * a->x_left;
-//             double c2 = b->y_left - m2 * b->x_left;
-//             double x_star = (c2 - c1) / (m1 - m2);
-
-//             auto chosen1 = (a->evaluate((start + x_star) / 2.0) > b->evaluate((start + x_star) / 2.0)) ? a : b;
-//             result.add_segment(std::make_shared<Segment>(
-//                 start, chosen1->evaluate(start),
-//                 x_star, chosen1->evaluate(x_star)
-//             ));
-
-//             auto chosen2 = (a->evaluate((x_star + end) / 2.0) > b->evaluate((x_star + end) / 2.0)) ? a : b;
-//             result.add_segment(std::make_shared<Segment>(
-//                 x_star, chosen2->evaluate(x_star),
-//                 end, chosen2->evaluate(end)
-//             ));
-//         }
-
-//         if (a->x_right <= end) a = a->next;
-//         if (b->x_right <= end) b = b->next;
-//     }
-
-//     result.simplify();
-//     return result;
-// }
-
-// PiecewiseLinearFunction min_function_with_constant(const PiecewiseLinearFunction& f, const PiecewiseLinearFunction& g) {
-//     PiecewiseLinearFunction result;
-//     auto seg = f.head;
-//     auto c = g.head;
-
-//     double constant = c->y_left;  // on suppose g est constante
-
-//     while (seg) {
-//         double fa_start = seg->evaluate(seg->x_left);
-//         double fa_end = seg->evaluate(seg->x_right);
-//         bool intersects = (fa_start - constant) * (fa_end - constant) < 0;
-
-//         if (!intersects) {
-//             if (fa_start <= constant && fa_end <= constant) {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     seg->x_left, fa_start,
-//                     seg->x_right, fa_end
-//                 ));
-//             } else {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     seg->x_left, constant,
-//                     seg->x_right, constant
-//                 ));
-//             }
-//         } else {
-//             double m = seg->get_slope();
-//             double c1 = seg->y_left - m * seg->x_left;
-//             double x_star = (constant - c1) / m;
-
-//             if (fa_start > constant) {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     seg->x_left, constant,
-//                     x_star, constant
-//                 ));
-//             } else {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     seg->x_left, fa_start,
-//                     x_star, constant
-//                 ));
-//             }
-
-//             if (fa_end > constant) {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     x_star, constant,
-//                     seg->x_right, constant
-//                 ));
-//             } else {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     x_star, constant,
-//                     seg->x_right, fa_end
-//                 ));
-//             }
-//         }
-
-//         seg = seg->next;
-//     }
-//     result.simplify();
-//     return result;
-// }
-
-// PiecewiseLinearFunction max_function_with_constant(const PiecewiseLinearFunction& f, const PiecewiseLinearFunction& g) {
-//     PiecewiseLinearFunction result;
-//     auto seg = f.head;
-//     auto c = g.head;
-
-//     double constant = c->y_left;  // on suppose g est constante
-
-//     while (seg) {
-//         double fa_start = seg->evaluate(seg->x_left);
-//         double fa_end = seg->evaluate(seg->x_right);
-//         bool intersects = (fa_start - constant) * (fa_end - constant) < 0;
-
-//         if (!intersects) {
-//             if (fa_start >= constant && fa_end >= constant) {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     seg->x_left, fa_start,
-//                     seg->x_right, fa_end
-//                 ));
-//             } else {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     seg->x_left, constant,
-//                     seg->x_right, constant
-//                 ));
-//             }
-//         } else {
-//             double m = seg->get_slope();
-//             double c1 = seg->y_left - m * seg->x_left;
-//             double x_star = (constant - c1) / m;
-
-//             if (fa_start > constant) {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     seg->x_left, fa_start,
-//                     x_star, constant
-//                 ));
-//             } else {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     seg->x_left, constant,
-//                     x_star, constant
-//                 ));
-//             }
-
-//             if (fa_end > constant) {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     x_star, constant,
-//                     seg->x_right, fa_end
-//                 ));
-//             } else {
-//                 result.add_segment(std::make_shared<Segment>(
-//                     x_star, constant,
-//                     seg->x_right, constant
-//                 ));
-//             }
-//         }
-
-//         seg = seg->next;
-//     }
-//     result.simplify();
-//     return result;
-// }
+// Enveloppe inférieure (take_min) ou supérieure de f1 et f2 en une seule fusion des deux listes :
+// sur chaque intervalle commun, si f1 - f2 change de signe le point de croisement est inséré.
+void envelope_into(const PiecewiseLinearFunction& f1, const PiecewiseLinearFunction& f2, bool take_min,
+                   PiecewiseLinearFunction& result) {
+    result.clear();
+    result.reserve(f1.pool.size() + f2.pool.size());
+    uint32_t a = f1.head;
+    uint32_t b = f2.head;
+    auto pick = [take_min](double fa, double fb) { return take_min ? std::min(fa, fb) : std::max(fa, fb); };
+
+    while (a != NIL && b != NIL) {
+        const Segment& sa = f1.segment(a);
+        const Segment& sb = f2.segment(b);
+        double start = std::max(sa.x_left, sb.x_left);
+        double end = std::min(sa.x_right, sb.x_right);
+
+        if (start > end) {
+            if (sa.x_right < sb.x_right) a = sa.next;
+            else b = sb.next;
+            continue;
+        }
+
+        if (start < end) {
+            double fa_start = sa.evaluate(start);
+            double fa_end = sa.evaluate(end);
+            double fb_start = sb.evaluate(start);
+            double fb_end = sb.evaluate(end);
+            double d_start = fa_start - fb_start;
+            double d_end = fa_end - fb_end;
+
+            bool intersect = (d_start < 0 && d_end > 0) || (d_start > 0 && d_end < 0);
+            if (intersect) {
+                double t = d_start / (d_start - d_end);
+                double x_star = start + t * (end - start);
+                double y_star = fa_start + t * (fa_end - fa_start);
+                result.add_segment(start, pick(fa_start, fb_start), x_star, y_star);
+                result.add_segment(x_star, y_star, end, pick(fa_end, fb_end));
+            } else {
+                result.add_segment(start, pick(fa_start, fb_start), end, pick(fa_end, fb_end));
+            }
+        }
+
+        if (sa.x_right <= end) a = sa.next;
+        if (sb.x_right <= end) b = sb.next;
+    }
+    result.simplify();
+}
+
+// min(f, c) / max(f, c) en un passage : les segments qui traversent y = c sont coupés au croisement
+void clamp_into(const PiecewiseLinearFunction& f, double constant, bool take_min, PiecewiseLinearFunction& result) {
+    result.clear();
+    result.reserve(f.pool.size() + 8);
+    auto pick = [take_min](double v, double c) { return take_min ? std::min(v, c) : std::max(v, c); };
+
+    for (uint32_t s = f.head; s != NIL; s = f.segment(s).next) {
+        const Segment& seg = f.segment(s);
+        double fa_start = seg.y_left;
+        double fa_end = seg.y_right;
+        bool intersects = (fa_start < constant && fa_end > constant) || (fa_start > constant && fa_end < constant);
+
+        if (!intersects) {
+            result.add_segment(seg.x_left, pick(fa_start, constant), seg.x_right, pick(fa_end, constant));
+        } else {
+            double t = (constant - fa_start) / (fa_end - fa_start);
+            double x_star = seg.x_left + t * (seg.x_right - seg.x_left);
+            result.add_segment(seg.x_left, pick(fa_start, constant), x_star, constant);
+            result.add_segment(x_star, constant, seg.x_right, pick(fa_end, constant));
+        }
+    }
+    result.simplify();
+}
+
+PiecewiseLinearFunction min_functions(const PiecewiseLinearFunction& f1, const PiecewiseLinearFunction& f2) {
+    PiecewiseLinearFunction result;
+    envelope_into(f1, f2, true, result);
+    return result;
+}
+
+PiecewiseLinearFunction max_functions(const PiecewiseLinearFunction& f1, const PiecewiseLinearFunction& f2) {
+    PiecewiseLinearFunction result;
+    envelope_into(f1, f2, false, result);
+    return result;
+}
+
+PiecewiseLinearFunction min_function_with_constant(const PiecewiseLinearFunction& f, double constant) {
+    PiecewiseLinearFunction result;
+    clamp_into(f, constant, true, result);
+    return result;
+}
+
+PiecewiseLinearFunction max_function_with_constant(const PiecewiseLinearFunction& f, double constant) {
+    PiecewiseLinearFunction result;
+    clamp_into(f, constant, false, result);
+    return result;
+}
+
+// g est supposée constante : sa valeur est lue sur son premier segment
+PiecewiseLinearFunction min_function_with_constant(const PiecewiseLinearFunction& f, const PiecewiseLinearFunction& g) {
+    if (g.head == NIL) return min_function_with_constant(f, 0.0);   // g vide : fonction nulle
+    return min_function_with_constant(f, g.segment(g.head).y_left);
+}
+
+PiecewiseLinearFunction max_function_with_constant(const PiecewiseLinearFunction& f, const PiecewiseLinearFunction& g) {
+    if (g.head == NIL) return max_function_with_constant(f, 0.0);   // g vide : fonction nulle
+    return max_function_with_constant(f, g.segment(g.head).y_left);
+}
 
 
 }
@@ -0,0 +1,425 @@
+#ifndef PIECEWISE_BINARY_HPP
+#define PIECEWISE_BINARY_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "piecewise.hpp"
+#include "piecewise_map.hpp"
+#include "piecewise_flat.hpp"
+#include "piecewise_simd.hpp"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "piecewise_binary.hpp : format little-endian, lu sans conversion"
+#endif
+
+// Format binaire versionné des profils, lisible sans analyse depuis un fichier projeté (mmap).
+//
+// Un fichier est un lot (bundle) de profils :
+//   en-tête de lot (64 octets) | table des positions (count x uint64) | blocs de profils
+// Chaque bloc commence par un en-tête de profil (64 octets) suivi de tableaux de double contigus,
+// tous alignés sur 64 octets :
+//   MAP  : x, valeur absolue f(x), deltaY   (map_version, relu exactement par sum)
+//   FLAT : x, valeur absolue f(x)            (flat_version)
+//   LIST : x_left, y_left, x_right, y_right  (list_version, un segment par indice)
+// Les entiers et les double sont en little-endian, sans conversion à la lecture.
+//
+// Ouvrir un lot ne lit que l'en-tête : les pages des profils ne sont chargées qu'à l'usage,
+// le coût de démarrage ne dépend donc pas du nombre de profils.
+
+namespace binary {
+
+const uint32_t VERSION = 1;
+const size_t ALIGN = 64;
+
+enum class Layout : uint16_t { MAP = 1, FLAT = 2, LIST = 3 };
+
+struct BundleHeader {
+    char magic[8];          // "PWLBNDL"
+    uint32_t version;
+    uint32_t count;         // nombre de profils
+    uint64_t table_offset;  // position de la table des blocs
+    uint64_t file_size;
+    uint8_t reserved[32];
+};
+
+struct ProfileHeader {
+    char magic[4];          // "PWLF"
+    uint16_t version;
+    Layout layout;
+    uint64_t size;          // nombre de points (MAP/FLAT) ou de segments (LIST)
+    uint64_t arrays[4];     // position de chaque tableau depuis le début du bloc (0 : absent)
+    uint8_t reserved[16];
+};
+
+static_assert(sizeof(BundleHeader) == 64, "en-tête de lot : 64 octets");
+static_assert(sizeof(ProfileHeader) == 64, "en-tête de profil : 64 octets");
+
+inline size_t aligned(size_t n) { return (n + ALIGN - 1) / ALIGN * ALIGN; }
+
+//=================================================================================================================
+//======================================  Écriture                            =====================================
+//=================================================================================================================
+// Les profils sont sérialisés dans un tampon en mémoire, puis écrits en une fois par save()
+class BundleWriter {
+public:
+    void add(const map_version::PiecewiseLinearFunction& f) {
+        std::vector<double> x, y, d;
+        x.reserve(f.size());
+        y.reserve(f.size());
+        d.reserve(f.size());
+        double v = 0.0;
+        for (const auto& kv : f) {
+            v += kv.second;
+            x.push_back(kv.first);
+            y.push_back(v);
+            d.push_back(kv.second);
+        }
+        addBlock(Layout::MAP, x.size(), {&x, &y, &d});
+    }
+
+    void add(const flat_version::PiecewiseLinearFunction& f) {
+        addBlock(Layout::FLAT, f.size(), {&f.abscissas(), &f.values()});
+    }
+
+    void add(const list_version::PiecewiseLinearFunction& f) {
+        std::vector<double> xl, yl, xr, yr;
+        for (uint32_t s = f.head; s != list_version::NIL; s = f.segment(s).next) {
+            const list_version::Segment& seg = f.segment(s);
+            xl.push_back(seg.x_left);
+            yl.push_back(seg.y_left);
+            xr.push_back(seg.x_right);
+            yr.push_back(seg.y_right);
+        }
+        addBlock(Layout::LIST, xl.size(), {&xl, &yl, &xr, &yr});
+    }
+
+    size_t count() const { return offsets.size(); }
+
+    bool save(const std::string& filename) const {
+        std::ofstream out(filename, std::ios::binary);
+        if (!out) {
+            std::cerr << "Erreur: impossible d'ouvrir le fichier " << filename << std::endl;
+            return false;
+        }
+
+        uint64_t table_offset = sizeof(BundleHeader);
+        uint64_t data_offset = aligned(table_offset + offsets.size() * sizeof(uint64_t));
+
+        BundleHeader h{};
+        std::memcpy(h.magic, "PWLBNDL", 8);
+        h.version = VERSION;
+        h.count = static_cast<uint32_t>(offsets.size());
+        h.table_offset = table_offset;
+        h.file_size = data_offset + blocks.size();
+
+        std::vector<uint64_t> table(offsets.size());
+        for (size_t i = 0; i < offsets.size(); ++i) table[i] = data_offset + offsets[i];
+        std::vector<char> padding(data_offset - table_offset - table.size() * sizeof(uint64_t), 0);
+
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(uint64_t));
+        out.write(padding.data(), padding.size());
+        out.write(blocks.data(), blocks.size());
+        return static_cast<bool>(out);
+    }
+
+private:
+    std::vector<char> blocks;        // blocs de profils, chacun aligné sur 64 octets
+    std::vector<uint64_t> offsets;   // début de chaque bloc dans blocks
+
+    void addBlock(Layout layout, size_t n, std::initializer_list<const std::vector<double>*> arrays) {
+        size_t start = blocks.size();
+        size_t pos = sizeof(ProfileHeader);
+
+        ProfileHeader h{};
+        std::memcpy(h.magic, "PWLF", 4);
+        h.version = static_cast<uint16_t>(VERSION);
+        h.layout = layout;
+        h.size = n;
+        size_t k = 0;
+        for (size_t a = 0; a < arrays.size(); ++a) {
+            pos = aligned(pos);
+            h.arrays[k++] = pos;
+            pos += n * sizeof(double);
+        }
+
+        blocks.resize(start + aligned(pos), 0);
+        std::memcpy(blocks.data() + start, &h, sizeof(h));
+        k = 0;
+        for (const std::vector<double>* a : arrays) {
+            if (n > 0) std::memcpy(blocks.data() + start + h.arrays[k], a->data(), n * sizeof(double));
+            ++k;
+        }
+        offsets.push_back(start);
+    }
+};
+
+// Écriture d'un seul profil : un lot d'un élément
+template<typename Function>
+bool save(const Function& f, const std::string& filename) {
+    BundleWriter writer;
+    writer.add(f);
+    return writer.save(filename);
+}
+
+//=================================================================================================================
+//======================================  Lecture : vue sur un profil projeté =====================================
+//=================================================================================================================
+
+// Parcours (x, deltaY) d'un profil MAP, accepté directement par map_version::sumPoints
+class DeltaIterator {
+public:
+    struct Point {
+        double first, second;
+        const Point* operator->() const { return this; }
+    };
+
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Point;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Point;
+    using reference = Point;
+
+    DeltaIterator(const double* x, const double* d) : x(x), d(d) {}
+
+    Point operator*() const { return {*x, *d}; }
+    Point operator->() const { return {*x, *d}; }
+    DeltaIterator& operator++() { ++x; ++d; return *this; }
+    DeltaIterator& operator--() { --x; --d; return *this; }
+    bool operator==(const DeltaIterator& o) const { return x == o.x; }
+    bool operator!=(const DeltaIterator& o) const { return x != o.x; }
+
+private:
+    const double* x;
+    const double* d;
+};
+
+// Vue en lecture seule sur un bloc : aucun tableau n'est copié
+class ProfileView {
+public:
+    ProfileView(const ProfileHeader* h) : header(h) {}
+
+    Layout layout() const { return header->layout; }
+    size_t size() const { return header->size; }
+
+    const double* array(size_t k) const {
+        return reinterpret_cast<const double*>(reinterpret_cast<const char*>(header) + header->arrays[k]);
+    }
+
+    // Mêmes conventions que la fonction écrite (map/flat : EPSILON et interpolation, list : segments)
+    double evaluate(double x) const {
+        size_t n = size();
+        if (n == 0) return 0.0;
+        if (layout() == Layout::LIST) {
+            const double* xl = array(0);
+            const double* yl = array(1);
+            const double* xr = array(2);
+            const double* yr = array(3);
+            size_t j = static_cast<size_t>(std::lower_bound(xr, xr + n, x) - xr);
+            if (j == n || x < xl[j]) return 0.0;
+            double slope = (yr[j] - yl[j]) / (xr[j] - xl[j]);
+            return yl[j] + slope * (x - xl[j]);
+        }
+        const double* bx = array(0);
+        const double* by = array(1);
+        if (x < bx[0]) return 0.0;
+        return simd::interpolate_at(bx, by, n, x, simd::count_below(bx, n, x, map_version::EPSILON));
+    }
+
+    void evaluate_many(const double* xs, double* out, size_t count) const {
+        size_t n = size();
+        if (layout() != Layout::LIST) {
+            simd::interpolate_many(array(0), array(1), n, xs, out, count, map_version::EPSILON);
+            return;
+        }
+        std::vector<double> slope(n);
+        for (size_t j = 0; j < n; ++j) slope[j] = (array(3)[j] - array(1)[j]) / (array(2)[j] - array(0)[j]);
+        simd::segments_many(array(0), array(1), array(2), slope.data(), n, xs, out, count);
+    }
+
+    // f += ce profil, lu directement dans les pages projetées (profils MAP)
+    void sum_into(map_version::PiecewiseLinearFunction& f) const {
+        if (layout() != Layout::MAP) throw std::runtime_error("sum_into : profil MAP attendu");
+        const double* x = array(0);
+        const double* d = array(2);
+        f.sumPoints(DeltaIterator(x, d), DeltaIterator(x + size(), d + size()));
+    }
+
+    // Copies modifiables
+    map_version::PiecewiseLinearFunction to_map() const {
+        map_version::PiecewiseLinearFunction f;
+        f.clear();
+        const double* x = array(0);
+        if (layout() == Layout::MAP) {
+            for (size_t i = 0; i < size(); ++i) f.appendBreakpoint(x[i], array(2)[i]);
+        } else if (layout() == Layout::FLAT) {
+            double prev = 0.0;
+            for (size_t i = 0; i < size(); ++i) {
+                f.appendBreakpoint(x[i], array(1)[i] - prev);
+                prev = array(1)[i];
+            }
+        } else {
+            throw std::runtime_error("to_map : profil MAP ou FLAT attendu");
+        }
+        return f;
+    }
+
+    flat_version::PiecewiseLinearFunction to_flat() const {
+        if (layout() == Layout::LIST) throw std::runtime_error("to_flat : profil MAP ou FLAT attendu");
+        flat_version::PiecewiseLinearFunction f;
+        f.clear();
+        f.reserve(size());
+        for (size_t i = 0; i < size(); ++i) f.push_back(array(0)[i], array(1)[i]);
+        return f;
+    }
+
+    list_version::PiecewiseLinearFunction to_list() const {
+        if (layout() != Layout::LIST) throw std::runtime_error("to_list : profil LIST attendu");
+        list_version::PiecewiseLinearFunction f;
+        f.reserve(size());
+        for (size_t i = 0; i < size(); ++i) f.add_segment(array(0)[i], array(1)[i], array(2)[i], array(3)[i]);
+        return f;
+    }
+
+private:
+    const ProfileHeader* header;
+};
+
+//=================================================================================================================
+//======================================  Lecture : lot projeté en mémoire    =====================================
+//=================================================================================================================
+// Projette le fichier en lecture seule (mmap, ou MapViewOfFile sous Windows). L'ouverture ne
+// vérifie que l'en-tête du lot (O(1)) ; chaque profil est vérifié à son premier accès par
+// operator[], sans toucher à ses tableaux. Erreurs de format : std::runtime_error.
+class Bundle {
+public:
+    explicit Bundle(const std::string& filename) {
+        map(filename);
+        try {
+            check(filename);
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    ~Bundle() { unmap(); }
+
+    Bundle(const Bundle&) = delete;
+    Bundle& operator=(const Bundle&) = delete;
+
+    Bundle(Bundle&& o) noexcept : base(o.base), length(o.length) {
+        o.base = nullptr;
+        o.length = 0;
+    }
+
+    size_t size() const { return header().count; }
+
+    ProfileView operator[](size_t i) const {
+        if (i >= size()) throw std::out_of_range("indice de profil hors du lot");
+        uint64_t off = table()[i];
+        // bornes par soustraction : des positions énormes ne doivent pas déborder et passer le test
+        if (off % ALIGN != 0 || off > length - sizeof(ProfileHeader)) {
+            throw std::runtime_error("position de profil invalide");
+        }
+        const ProfileHeader* p = reinterpret_cast<const ProfileHeader*>(base + off);
+        if (std::memcmp(p->magic, "PWLF", 4) != 0 || p->version != VERSION ||
+            (p->layout != Layout::MAP && p->layout != Layout::FLAT && p->layout != Layout::LIST)) {
+            throw std::runtime_error("en-tête de profil invalide");
+        }
+        size_t arrays = (p->layout == Layout::FLAT) ? 2 : (p->layout == Layout::MAP ? 3 : 4);
+        for (size_t k = 0; k < arrays; ++k) {
+            if (p->arrays[k] % ALIGN != 0 || p->arrays[k] > length - off ||
+                p->size > (length - off - p->arrays[k]) / sizeof(double)) {
+                throw std::runtime_error("profil tronqué");
+            }
+        }
+        return ProfileView(p);
+    }
+
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+
+#if defined(_WIN32)
+    void map(const std::string& filename) {
+        HANDLE file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("impossible d'ouvrir le fichier " + filename);
+        LARGE_INTEGER st;
+        if (!::GetFileSizeEx(file, &st) || st.QuadPart < static_cast<LONGLONG>(sizeof(BundleHeader))) {
+            ::CloseHandle(file);
+            throw std::runtime_error("fichier de profils invalide : " + filename);
+        }
+        length = static_cast<size_t>(st.QuadPart);
+        // la vue garde la projection ouverte : les deux handles peuvent être fermés
+        HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        ::CloseHandle(file);
+        if (!mapping) throw std::runtime_error("projection impossible : " + filename);
+        void* p = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        ::CloseHandle(mapping);
+        if (!p) throw std::runtime_error("projection impossible : " + filename);
+        base = static_cast<const char*>(p);
+    }
+
+    void unmap() {
+        if (base) ::UnmapViewOfFile(base);
+    }
+#else
+    void map(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("impossible d'ouvrir le fichier " + filename);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(BundleHeader))) {
+            ::close(fd);
+            throw std::runtime_error("fichier de profils invalide : " + filename);
+        }
+        length = static_cast<size_t>(st.st_size);
+        void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("mmap impossible : " + filename);
+        base = static_cast<const char*>(p);
+    }
+
+    void unmap() {
+        if (base) ::munmap(const_cast<char*>(base), length);
+    }
+#endif
+
+    const BundleHeader& header() const { return *reinterpret_cast<const BundleHeader*>(base); }
+    const uint64_t* table() const { return reinterpret_cast<const uint64_t*>(base + header().table_offset); }
+
+    void check(const std::string& filename) const {
+        const BundleHeader& h = header();
+        if (std::memcmp(h.magic, "PWLBNDL", 8) != 0) throw std::runtime_error("pas un lot de profils : " + filename);
+        if (h.version != VERSION) throw std::runtime_error("version de format non prise en charge : " + filename);
+        if (h.file_size != length || h.table_offset % sizeof(uint64_t) != 0 || h.table_offset > length ||
+            h.count > (length - h.table_offset) / sizeof(uint64_t)) {
+            throw std::runtime_error("lot de profils tronqué : " + filename);
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,392 @@
+#ifndef PIECEWISE_COMPRESSED_HPP
+#define PIECEWISE_COMPRESSED_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include "piecewise.hpp"
+#include "piecewise_map.hpp"
+
+namespace compressed_version {
+
+// Représentation compacte, en lecture seule, des profils froids (historiques, gabarits).
+//
+// Les points sont codés à la suite dans un flux d'octets :
+//  - abscisses : si toutes sont entières (|x| < 2^53), différence avec l'abscisse précédente en
+//    varint zigzag (1 octet pour un pas < 64) ; sinon XOR des bits avec l'abscisse précédente ;
+//  - valeurs : XOR des bits avec la valeur précédente, écrit comme un octet de zéros de poids
+//    faible puis la partie significative en varint (1 octet si la valeur se répète, 2 pour un
+//    changement de signe comme dans un zigzag).
+// Le flux est découpé en blocs de BLOCK points dont les prédicteurs repartent de zéro ; un petit
+// index garde pour chaque bloc sa première abscisse, sa position et (map) la valeur cumulée avant
+// lui. evaluate décode au plus deux blocs, le parcours et sum décodent à la volée : la fonction
+// n'est jamais décompressée en entier.
+//
+// Layout MAP : (x, deltaY) de map_version, mêmes conventions d'évaluation (EPSILON, valeurs
+// cumulées dans le même ordre : résultats identiques bit à bit ; un tag affine est appliqué à la
+// compression, comme materialize()). Layout LIST : segments de
+// list_version ; un segment qui prolonge le précédent (x_left, y_left = x_right, y_right précédents)
+// ne coûte qu'un octet d'en-tête en plus de son extrémité droite.
+
+enum class Layout : uint8_t { MAP = 1, LIST = 2 };
+
+constexpr size_t BLOCK = 64;
+
+namespace detail {
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+inline uint64_t get_varint(const uint8_t*& p) {
+    uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+}
+
+inline uint64_t bits(double v) {
+    uint64_t b;
+    std::memcpy(&b, &v, 8);
+    return b;
+}
+
+inline double from_bits(uint64_t b) {
+    double v;
+    std::memcpy(&v, &b, 8);
+    return v;
+}
+
+// XOR avec la valeur précédente : [zéros de poids faible, 64 si identique][reste en varint]
+inline void put_xor(std::vector<uint8_t>& out, uint64_t& prev, double v) {
+    uint64_t x = bits(v) ^ prev;
+    prev = bits(v);
+    if (x == 0) {
+        out.push_back(64);
+        return;
+    }
+    uint8_t tz = static_cast<uint8_t>(__builtin_ctzll(x));
+    out.push_back(tz);
+    put_varint(out, x >> tz);
+}
+
+inline double get_xor(const uint8_t*& p, uint64_t& prev) {
+    uint8_t tz = *p++;
+    if (tz != 64) prev ^= get_varint(p) << tz;
+    return from_bits(prev);
+}
+
+// Prédicteurs d'un bloc (remis à zéro au début de chaque bloc)
+struct State {
+    double x = 0.0;      // dernière abscisse (mode entier)
+    uint64_t xb = 0;     // bits de la dernière abscisse (mode XOR)
+    uint64_t yb = 0;     // bits de la dernière valeur
+};
+
+}
+
+class CompressedProfile {
+public:
+    struct Block {
+        double x0;          // première abscisse (map : x ; list : x_right du premier segment)
+        double y_before;    // map : valeur cumulée avant le bloc
+        uint32_t offset;    // position dans le flux
+    };
+
+    // Point (x, deltaY) décodé, au format des itérateurs de map_version
+    struct Point {
+        double first, second;
+        const Point* operator->() const { return this; }
+    };
+
+    // Parcours des points du layout MAP, décodés à la volée. Bidirectionnel pour sumPoints :
+    // -- redécode depuis le début du bloc (O(BLOCK)).
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = Point;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Point;
+        using reference = Point;
+
+        const_iterator() = default;
+
+        Point operator*() const { return current; }
+        Point operator->() const { return current; }
+
+        const_iterator& operator++() {
+            ++k;
+            if (k < owner->count) decode();
+            return *this;
+        }
+        const_iterator& operator--() {
+            seek(k - 1);
+            return *this;
+        }
+        bool operator==(const const_iterator& o) const { return k == o.k; }
+        bool operator!=(const const_iterator& o) const { return k != o.k; }
+
+    private:
+        friend class CompressedProfile;
+        const CompressedProfile* owner = nullptr;
+        size_t k = 0;
+        const uint8_t* p = nullptr;
+        detail::State s;
+        Point current{0.0, 0.0};
+
+        const_iterator(const CompressedProfile* o, size_t index) : owner(o) { seek(index); }
+
+        void seek(size_t index) {
+            k = index;
+            if (k >= owner->count) return;
+            size_t b = k / BLOCK;
+            p = owner->stream.data() + owner->blocks[b].offset;
+            size_t target = k;
+            for (k = b * BLOCK; k <= target; ++k) decode();
+            k = target;
+        }
+
+        void decode() {
+            if (k % BLOCK == 0) s = detail::State();
+            current.first = owner->getX(p, s);
+            current.second = detail::get_xor(p, s.yb);
+        }
+    };
+
+    CompressedProfile() = default;
+
+    template<typename X>
+    explicit CompressedProfile(const map_version::BasicPiecewiseLinearFunction<X>& f) : layout_(Layout::MAP) {
+        std::vector<double> xs;
+        xs.reserve(f.size());
+        for (const auto& p : f) xs.push_back(static_cast<double>(p.first));
+        integral = all_integral(xs);
+
+        detail::State s;
+        double y = 0.0;
+        size_t k = 0;
+        for (const auto& p : f) {
+            double x = static_cast<double>(p.first);
+            if (k % BLOCK == 0) {
+                blocks.push_back({x, y, static_cast<uint32_t>(stream.size())});
+                s = detail::State();
+            }
+            putX(s, x);
+            detail::put_xor(stream, s.yb, p.second);
+            y += p.second;   // même ordre d'addition que map_version::eval
+            ++k;
+        }
+        count = k;
+        finish();
+    }
+
+    explicit CompressedProfile(const list_version::PiecewiseLinearFunction& f) : layout_(Layout::LIST) {
+        std::vector<double> xs;
+        for (uint32_t i = f.head; i != list_version::NIL; i = f.segment(i).next) {
+            xs.push_back(f.segment(i).x_left);
+            xs.push_back(f.segment(i).x_right);
+        }
+        integral = all_integral(xs);
+
+        detail::State s;
+        double xr_prev = 0.0, yr_prev = 0.0;
+        size_t k = 0;
+        for (uint32_t i = f.head; i != list_version::NIL; i = f.segment(i).next) {
+            const list_version::Segment& seg = f.segment(i);
+            bool fresh = k % BLOCK == 0;
+            if (fresh) {
+                blocks.push_back({seg.x_right, 0.0, static_cast<uint32_t>(stream.size())});
+                s = detail::State();
+            }
+            // en-tête : 1 si le segment prolonge le précédent (extrémité gauche omise)
+            bool joined = !fresh && seg.x_left == xr_prev && detail::bits(seg.y_left) == detail::bits(yr_prev);
+            stream.push_back(joined ? 1 : 0);
+            if (!joined) {
+                putX(s, seg.x_left);
+                detail::put_xor(stream, s.yb, seg.y_left);
+            }
+            putX(s, seg.x_right);
+            detail::put_xor(stream, s.yb, seg.y_right);
+            xr_prev = seg.x_right;
+            yr_prev = seg.y_right;
+            ++k;
+        }
+        count = k;
+        finish();
+    }
+
+    Layout layout() const { return layout_; }
+    size_t size() const { return count; }                     // points (map) ou segments (list)
+    bool integralAbscissas() const { return integral; }
+
+    // Mémoire occupée : objet, flux et index
+    size_t bytes() const {
+        return sizeof(*this) + stream.capacity() + blocks.capacity() * sizeof(Block);
+    }
+
+    // Points (x, deltaY) du layout MAP
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    // Segments du layout LIST, dans l'ordre : visit(const list_version::Segment&)
+    template<typename Visit>
+    void forEachSegment(Visit visit) const {
+        const uint8_t* p = stream.data();
+        detail::State s;
+        list_version::Segment seg(0.0, 0.0, 0.0, 0.0);
+        for (size_t k = 0; k < count; ++k) {
+            decodeSegment(p, s, k, seg);
+            visit(seg);
+        }
+    }
+
+    double evaluate(double x) const {
+        if (count == 0) return 0.0;
+        return layout_ == Layout::MAP ? evaluateMap(x) : evaluateList(x);
+    }
+
+    // f += ce profil (MAP), décodé à la volée par le balayage de f.sum(g)
+    template<typename X>
+    void sum_into(map_version::BasicPiecewiseLinearFunction<X>& f) const {
+        if (layout_ != Layout::MAP) throw std::runtime_error("sum_into : profil MAP attendu");
+        f.sumPoints(begin(), end());
+    }
+
+    // f += ce profil (LIST) ; list_version::add prend une liste : les segments sont décodés dans
+    // une liste temporaire
+    void sum_into(list_version::PiecewiseLinearFunction& f) const {
+        f.add(to_list());
+    }
+
+    // Copies modifiables
+    template<typename X = double>
+    map_version::BasicPiecewiseLinearFunction<X> to_map() const {
+        if (layout_ != Layout::MAP) throw std::runtime_error("to_map : profil MAP attendu");
+        map_version::BasicPiecewiseLinearFunction<X> f;
+        f.clear();
+        for (const auto& p : *this) f.appendBreakpoint(static_cast<X>(p.first), p.second);
+        return f;
+    }
+
+    list_version::PiecewiseLinearFunction to_list() const {
+        if (layout_ != Layout::LIST) throw std::runtime_error("to_list : profil LIST attendu");
+        list_version::PiecewiseLinearFunction f;
+        f.reserve(count);
+        forEachSegment([&](const list_version::Segment& seg) {
+            f.add_segment(seg.x_left, seg.y_left, seg.x_right, seg.y_right);
+        });
+        return f;
+    }
+
+private:
+    Layout layout_ = Layout::MAP;
+    bool integral = true;
+    size_t count = 0;
+    std::vector<uint8_t> stream;
+    std::vector<Block> blocks;
+
+    static bool all_integral(const std::vector<double>& xs) {
+        for (double x : xs) {
+            if (!(std::fabs(x) < 9007199254740992.0) || x != std::trunc(x)) return false;
+        }
+        return true;
+    }
+
+    void finish() {
+        stream.shrink_to_fit();
+        blocks.shrink_to_fit();
+    }
+
+    void putX(detail::State& s, double x) {
+        if (integral) {
+            int64_t d = static_cast<int64_t>(x) - static_cast<int64_t>(s.x);
+            detail::put_varint(stream, (static_cast<uint64_t>(d) << 1) ^ static_cast<uint64_t>(d >> 63));
+            s.x = x;
+        } else {
+            detail::put_xor(stream, s.xb, x);
+        }
+    }
+
+    double getX(const uint8_t*& p, detail::State& s) const {
+        if (integral) {
+            uint64_t z = detail::get_varint(p);
+            int64_t d = static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1);
+            s.x = static_cast<double>(static_cast<int64_t>(s.x) + d);
+            return s.x;
+        }
+        return detail::get_xor(p, s.xb);
+    }
+
+    void decodeSegment(const uint8_t*& p, detail::State& s, size_t k, list_version::Segment& seg) const {
+        if (k % BLOCK == 0) s = detail::State();
+        bool joined = *p++ != 0;
+        if (joined) {
+            seg.x_left = seg.x_right;
+            seg.y_left = seg.y_right;
+        } else {
+            seg.x_left = getX(p, s);
+            seg.y_left = detail::get_xor(p, s.yb);
+        }
+        seg.x_right = getX(p, s);
+        seg.y_right = detail::get_xor(p, s.yb);
+    }
+
+    // Premier bloc à décoder : le dernier dont la première abscisse est dépassée (ou le premier)
+    template<typename Passed>
+    size_t startBlock(Passed passed) const {
+        auto it = std::partition_point(blocks.begin(), blocks.end(), passed);
+        size_t b = static_cast<size_t>(it - blocks.begin());
+        return b == 0 ? 0 : b - 1;
+    }
+
+    // Même parcours que map_version::eval, à partir du bloc qui contient l'intervalle de x
+    double evaluateMap(double x) const {
+        using C = map_version::Coordinate<double>;
+        size_t b = startBlock([&](const Block& blk) { return !C::within(x, blk.x0); });
+        const uint8_t* p = stream.data() + blocks[b].offset;
+        detail::State s;
+        double x_prev = getX(p, s);
+        double y_prev = blocks[b].y_before + detail::get_xor(p, s.yb);
+        if (b == 0 && x < x_prev) return 0.0;
+
+        for (size_t k = b * BLOCK + 1; k < count; ++k) {
+            if (k % BLOCK == 0) s = detail::State();
+            double x_curr = getX(p, s);
+            double y_curr = y_prev + detail::get_xor(p, s.yb);
+            if (C::within(x, x_curr)) {
+                double slope = (y_curr - y_prev) / (x_curr - x_prev);
+                return y_prev + slope * (x - x_prev);
+            }
+            x_prev = x_curr;
+            y_prev = y_curr;
+        }
+        return y_prev;
+    }
+
+    // Même parcours que list_version::evaluate : premier segment tel que x <= x_right
+    double evaluateList(double x) const {
+        size_t b = startBlock([&](const Block& blk) { return blk.x0 < x; });
+        const uint8_t* p = stream.data() + blocks[b].offset;
+        detail::State s;
+        list_version::Segment seg(0.0, 0.0, 0.0, 0.0);
+        for (size_t k = b * BLOCK; k < count; ++k) {
+            decodeSegment(p, s, k, seg);
+            if (x <= seg.x_right) return (x < seg.x_left) ? 0.0 : seg.evaluate(x);
+        }
+        return 0.0;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef PIECEWISE_CONCURRENT_HPP
+#define PIECEWISE_CONCURRENT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace concurrent_version {
+
+// Profil partagé entre un (ou plusieurs) writers et de nombreux lecteurs, publication de type RCU.
+//
+// Les lecteurs ne prennent aucun verrou : ils lisent une version immuable du profil, publiée par
+// un pointeur atomique. Un writer recopie la version courante, la modifie hors de vue des
+// lecteurs, puis publie la copie d'un seul store ; les writers sont sérialisés entre eux par un
+// mutex que les lecteurs ne touchent jamais. La copie est O(1) pour persistent_version (les
+// versions partagent leurs noeuds) et O(n) pour map_version.
+//
+// Récupération par époques : chaque lecteur possède un slot où il annonce l'époque globale
+// pendant qu'il lit. Une version remplacée est retirée avec l'époque r courante au moment du
+// remplacement, puis l'époque avance ; un lecteur qui a pu la charger a annoncé une époque <= r.
+// La version est libérée dès que tous les slots actifs annoncent une époque > r. Un lecteur qui
+// reste longtemps épinglé retarde seulement la libération, jamais le writer.
+//
+// Profile doit être copiable et ses méthodes const sans état partagé (c'est le cas de
+// map_version, persistent_version et small_version ; les compteurs d'instrumentation sont
+// propres à chaque thread).
+template<typename Profile>
+class SharedProfile {
+    struct Version {
+        Profile f;
+        uint64_t number;
+    };
+
+    static constexpr uint64_t IDLE = std::numeric_limits<uint64_t>::max();
+
+    // un slot par ligne de cache : les annonces des lecteurs ne se gênent pas
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{IDLE};
+        std::atomic<bool> owned{false};
+    };
+
+public:
+    class Reader;
+
+    // Version immuable épinglée : valable jusqu'à sa destruction, même si d'autres versions sont
+    // publiées entre-temps. Un seul Snapshot vivant à la fois par Reader.
+    class Snapshot {
+    public:
+        Snapshot(Snapshot&& other) noexcept : slot(other.slot), v(other.v) { other.slot = nullptr; }
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+        ~Snapshot() {
+            if (slot) slot->epoch.store(IDLE, std::memory_order_release);
+        }
+
+        const Profile& operator*() const { return v->f; }
+        const Profile* operator->() const { return &v->f; }
+        uint64_t version() const { return v->number; }   // 0 pour le profil initial
+
+    private:
+        friend class Reader;
+        Snapshot(Slot* s, const Version* version) : slot(s), v(version) {}
+
+        Slot* slot;
+        const Version* v;
+    };
+
+    // Slot de lecture d'un thread, libéré à la destruction
+    class Reader {
+    public:
+        Reader(Reader&& other) noexcept : owner(other.owner), slot(other.slot) { other.slot = nullptr; }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        Reader& operator=(Reader&&) = delete;
+        ~Reader() {
+            if (slot) slot->owned.store(false, std::memory_order_release);
+        }
+
+        // Annonce de l'époque puis chargement de la version courante (sans verrou ni attente)
+        Snapshot pin() const {
+            slot->epoch.store(owner->epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            return Snapshot(slot, owner->current.load(std::memory_order_seq_cst));
+        }
+
+    private:
+        friend class SharedProfile;
+        Reader(const SharedProfile* p, Slot* s) : owner(p), slot(s) {}
+
+        const SharedProfile* owner;
+        Slot* slot;
+    };
+
+    explicit SharedProfile(Profile initial = Profile(), size_t max_readers = 64)
+        : slots(new Slot[max_readers]), slot_count(max_readers),
+          current(new Version{std::move(initial), 0}) {}
+
+    // Aucun Reader ni Snapshot ne doit survivre au profil
+    ~SharedProfile() {
+        delete current.load();
+        for (auto& r : retired) delete r.second;
+    }
+
+    SharedProfile(const SharedProfile&) = delete;
+    SharedProfile& operator=(const SharedProfile&) = delete;
+
+    // Réserve un slot de lecture ; std::runtime_error si les max_readers slots sont pris
+    Reader reader() const {
+        for (size_t i = 0; i < slot_count; ++i) {
+            bool expected = false;
+            if (slots[i].owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                return Reader(this, &slots[i]);
+            }
+        }
+        throw std::runtime_error("SharedProfile: plus de slot de lecture libre");
+    }
+
+    // Writer : mutate(Profile&) sur une copie de la version courante, puis publication.
+    // Plusieurs modifications groupées dans un même mutate ne coûtent qu'une copie.
+    // Renvoie le numéro de la version publiée.
+    template<typename Mutate>
+    uint64_t update(Mutate mutate) {
+        std::lock_guard<std::mutex> lock(writer);
+        const Version* old = current.load(std::memory_order_relaxed);
+        std::unique_ptr<Version> next(new Version{old->f, old->number + 1});
+        mutate(next->f);
+        return install(old, next.release());
+    }
+
+    // Writer : remplace le profil entier
+    uint64_t publish(Profile f) {
+        std::lock_guard<std::mutex> lock(writer);
+        const Version* old = current.load(std::memory_order_relaxed);
+        return install(old, new Version{std::move(f), old->number + 1});
+    }
+
+    // Libère les versions retirées que plus aucun lecteur ne peut voir ; fait aussi à chaque écriture
+    void reclaim() {
+        std::lock_guard<std::mutex> lock(writer);
+        collect();
+    }
+
+    // Versions remplacées encore en mémoire (lecteurs épinglés dessus)
+    size_t retiredCount() const {
+        std::lock_guard<std::mutex> lock(writer);
+        return retired.size();
+    }
+
+    uint64_t version() const { return current.load(std::memory_order_acquire)->number; }
+
+private:
+    std::unique_ptr<Slot[]> slots;
+    size_t slot_count;
+    std::atomic<const Version*> current;
+    std::atomic<uint64_t> epoch{0};
+    mutable std::mutex writer;
+    std::vector<std::pair<uint64_t, const Version*>> retired;   // (époque de retrait, version)
+
+    uint64_t install(const Version* old, const Version* next) {
+        current.store(next, std::memory_order_seq_cst);
+        uint64_t r = epoch.fetch_add(1, std::memory_order_seq_cst);
+        retired.emplace_back(r, old);
+        collect();
+        return next->number;
+    }
+
+    void collect() {
+        uint64_t oldest = IDLE;
+        for (size_t i = 0; i < slot_count; ++i) {
+            oldest = std::min(oldest, slots[i].epoch.load(std::memory_order_seq_cst));
+        }
+        size_t kept = 0;
+        for (auto& r : retired) {
+            if (r.first < oldest) {
+                delete r.second;
+            } else {
+                retired[kept++] = r;
+            }
+        }
+        retired.resize(kept);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef PIECEWISE_COUNTERS_HPP
+#define PIECEWISE_COUNTERS_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+// Compteurs d'instrumentation des chemins chauds, activés à la compilation par
+// -DPIECEWISE_COUNTERS. Sans ce drapeau, PWL_COUNT(...) ne produit aucun code.
+//
+// Les compteurs sont propres à chaque thread (thread_local) : counters::local() donne ceux du
+// thread courant, counters::reset() les remet à zéro. counters::NAMES et values() permettent de
+// les écrire en colonnes à côté des temps mesurés.
+
+namespace counters {
+
+struct Counters {
+    // map_version
+    uint64_t sum_calls = 0;
+    uint64_t sum_merge_steps = 0;       // abscisses de l'union parcourues par sum
+    uint64_t map_lookups = 0;           // lower_bound / upper_bound / find dans la map
+    uint64_t eval_calls = 0;
+    uint64_t eval_scan = 0;             // breakpoints parcourus par eval
+    uint64_t map_node_allocs = 0;
+    uint64_t map_node_frees = 0;
+    // list_version
+    uint64_t add_functions_calls = 0;
+    uint64_t add_functions_steps = 0;   // paires de segments examinées
+    uint64_t add_segment_calls = 0;
+    uint64_t segment_pool_growth = 0;   // add_segment sans segment libre à recycler
+    uint64_t simplify_calls = 0;
+    uint64_t simplify_visited = 0;
+    uint64_t simplify_merged = 0;
+
+    static constexpr size_t COUNT = 14;
+
+    void values(uint64_t* out) const {
+        const uint64_t v[COUNT] = {sum_calls, sum_merge_steps, map_lookups, eval_calls, eval_scan,
+                                   map_node_allocs, map_node_frees, add_functions_calls, add_functions_steps,
+                                   add_segment_calls, segment_pool_growth, simplify_calls, simplify_visited,
+                                   simplify_merged};
+        for (size_t i = 0; i < COUNT; ++i) out[i] = v[i];
+    }
+};
+
+constexpr const char* NAMES[Counters::COUNT] = {
+    "sum_calls", "sum_merge_steps", "map_lookups", "eval_calls", "eval_scan",
+    "map_node_allocs", "map_node_frees", "add_functions_calls", "add_functions_steps",
+    "add_segment_calls", "segment_pool_growth", "simplify_calls", "simplify_visited",
+    "simplify_merged"};
+
+#if defined(PIECEWISE_COUNTERS)
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+inline Counters& local() {
+    thread_local Counters c;
+    return c;
+}
+
+inline void reset() { local() = Counters(); }
+
+}
+
+#if defined(PIECEWISE_COUNTERS)
+#define PWL_COUNT(field, n) (::counters::local().field += static_cast<uint64_t>(n))
+#else
+#define PWL_COUNT(field, n) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef PIECEWISE_EXPR_HPP
+#define PIECEWISE_EXPR_HPP
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "piecewise_map.hpp"
+#include "piecewise_flat.hpp"
+
+// Expressions paresseuses sur les fonctions linéaires par morceaux (map_version et flat_version).
+//
+// f + g - h, -f, 2.0 * f ... ne calculent rien : ils construisent un petit arbre de noeuds qui
+// référence les opérandes. L'expression étant linéaire, elle se réduit à une somme pondérée
+// sum_i coef_i * f_i des feuilles ; à l'affectation (conversion vers la fonction, ou materialize),
+// un seul balayage k-voies des breakpoints de toutes les feuilles écrit le résultat, sans aucune
+// fonction intermédiaire (k est connu à la compilation : l'état du balayage tient dans des
+// std::array). evaluate(x) sur une expression évalue directement chaque feuille.
+//
+// Les opérandes doivent survivre à l'expression : ne pas garder une expression (auto e = f + g)
+// au-delà de la vie de f et g. Toutes les feuilles d'une expression ont le même type de fonction.
+
+namespace expr {
+
+// Parcours des points absolus (x, f(x)) d'une fonction, dans l'ordre croissant
+template<typename F> struct Cursor;
+
+template<> struct Cursor<map_version::PiecewiseLinearFunction> {
+    map_version::PiecewiseLinearFunction::const_iterator it, end;
+    double y = 0.0;   // valeur au dernier point dépassé
+
+    void init(const map_version::PiecewiseLinearFunction& f) {
+        it = f.begin();
+        end = f.end();
+        y = 0.0;
+    }
+    bool done() const { return it == end; }
+    double x() const { return it->first; }
+    double value() const { return y + it->second; }   // valeur au point courant
+    void advance() {
+        y += it->second;
+        ++it;
+    }
+};
+
+template<> struct Cursor<flat_version::PiecewiseLinearFunction> {
+    const double* xs = nullptr;
+    const double* ys = nullptr;
+    size_t i = 0, n = 0;
+
+    void init(const flat_version::PiecewiseLinearFunction& f) {
+        xs = f.abscissas().data();
+        ys = f.values().data();
+        i = 0;
+        n = f.size();
+    }
+    bool done() const { return i == n; }
+    double x() const { return xs[i]; }
+    double value() const { return ys[i]; }
+    void advance() { ++i; }
+};
+
+// Écriture du résultat en ordre croissant de x : deltaY pour la map, valeur absolue pour flat
+inline void beginOutput(map_version::PiecewiseLinearFunction& out) { out.clear(); }
+inline void beginOutput(flat_version::PiecewiseLinearFunction& out) { out.clear(); }
+
+inline void appendPoint(map_version::PiecewiseLinearFunction& out, double x, double y, double y_prev) {
+    out.appendBreakpoint(x, y - y_prev);
+}
+
+inline void appendPoint(flat_version::PiecewiseLinearFunction& out, double x, double y, double) {
+    out.push_back(x, y);
+}
+
+// Terme de la somme pondérée : une feuille et son coefficient
+template<typename F>
+struct Term {
+    const F* f = nullptr;
+    double coef = 0.0;
+};
+
+template<typename F> void materialize_into(const F&, F&);
+
+// Base CRTP des noeuds : évaluation directe et conversion (matérialisation en un balayage)
+template<typename Derived, typename F>
+struct Expression {
+    using function_type = F;
+    using expr_node = Derived;   // marque reconnue par is_node
+
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+
+    double evaluate(double x) const { return self().eval(x); }
+
+    operator F() const {
+        F out;
+        materialize_into(self(), out);
+        return out;
+    }
+};
+
+template<typename F>
+struct Leaf : Expression<Leaf<F>, F> {
+    static constexpr size_t count = 1;
+    const F& f;
+
+    explicit Leaf(const F& fn) : f(fn) {}
+
+    double eval(double x) const { return f.evaluate(x); }
+
+    template<size_t N>
+    void collect(std::array<Term<F>, N>& terms, size_t& k, double coef) const {
+        terms[k++] = {&f, coef};
+    }
+};
+
+template<typename L, typename R>
+struct Sum : Expression<Sum<L, R>, typename L::function_type> {
+    static constexpr size_t count = L::count + R::count;
+    L l;
+    R r;
+
+    Sum(const L& a, const R& b) : l(a), r(b) {}
+
+    double eval(double x) const { return l.eval(x) + r.eval(x); }
+
+    template<size_t N>
+    void collect(std::array<Term<typename L::function_type>, N>& terms, size_t& k, double coef) const {
+        l.collect(terms, k, coef);
+        r.collect(terms, k, coef);
+    }
+};
+
+template<typename L, typename R>
+struct Diff : Expression<Diff<L, R>, typename L::function_type> {
+    static constexpr size_t count = L::count + R::count;
+    L l;
+    R r;
+
+    Diff(const L& a, const R& b) : l(a), r(b) {}
+
+    double eval(double x) const { return l.eval(x) - r.eval(x); }
+
+    template<size_t N>
+    void collect(std::array<Term<typename L::function_type>, N>& terms, size_t& k, double coef) const {
+        l.collect(terms, k, coef);
+        r.collect(terms, k, -coef);
+    }
+};
+
+template<typename E>
+struct Scale : Expression<Scale<E>, typename E::function_type> {
+    static constexpr size_t count = E::count;
+    E e;
+    double factor;
+
+    Scale(const E& x, double k) : e(x), factor(k) {}
+
+    double eval(double x) const { return factor * e.eval(x); }
+
+    template<size_t N>
+    void collect(std::array<Term<typename E::function_type>, N>& terms, size_t& k, double coef) const {
+        e.collect(terms, k, coef * factor);
+    }
+};
+
+// Balayage k-voies : à chaque abscisse x de l'union des breakpoints, la valeur du résultat est
+// recalculée comme sum_i coef_i * f_i(x), chaque feuille étant évaluée en O(1) sur son segment
+// courant (pas de cumul de pentes, donc pas de dérive d'arrondi le long du balayage).
+// Comme sum_all, une feuille vaut 0 avant son premier point. out peut être une des feuilles
+// (f = f + g) : le résultat est alors écrit dans une fonction temporaire, puis déplacé dans out.
+template<typename E, typename F = typename E::function_type>
+void materialize_into(const E& e, F& out) {
+    constexpr size_t N = E::count;
+    std::array<Term<F>, N> terms;
+    size_t k = 0;
+    e.collect(terms, k, 1.0);
+
+    for (size_t i = 0; i < N; ++i) {
+        if (terms[i].f == &out) {
+            F result;
+            materialize_into(e, result);
+            out = std::move(result);
+            return;
+        }
+    }
+
+    // état de chaque feuille : dernier point dépassé (x_last, y_last) et pente du segment suivant
+    std::array<Cursor<F>, N> cursors;
+    std::array<double, N> x_last{}, y_last{}, slopes{};
+    for (size_t i = 0; i < N; ++i) cursors[i].init(*terms[i].f);
+
+    beginOutput(out);
+    double y_prev = 0.0;
+
+    for (;;) {
+        bool any = false;
+        double x = 0.0;
+        for (size_t i = 0; i < N; ++i) {
+            if (!cursors[i].done() && (!any || cursors[i].x() < x)) {
+                x = cursors[i].x();
+                any = true;
+            }
+        }
+        if (!any) break;
+
+        double y = 0.0;
+        for (size_t i = 0; i < N; ++i) {
+            Cursor<F>& c = cursors[i];
+            if (!c.done() && c.x() == x) {
+                double v = c.value();
+                y += terms[i].coef * v;
+                c.advance();
+                x_last[i] = x;
+                y_last[i] = v;
+                slopes[i] = c.done() ? 0.0 : (c.value() - v) / (c.x() - x);
+            } else {
+                // avant le premier point : x_last = y_last = pente = 0, donc contribution nulle
+                y += terms[i].coef * (y_last[i] + slopes[i] * (x - x_last[i]));
+            }
+        }
+
+        appendPoint(out, x, y, y_prev);
+        y_prev = y;
+    }
+}
+
+// Cas trivial : une fonction seule se copie
+template<typename F>
+void materialize_into(const F& f, F& out) {
+    if (&f != &out) out = f;
+}
+
+template<typename E>
+typename E::function_type materialize(const E& e) {
+    typename E::function_type out;
+    materialize_into(e, out);
+    return out;
+}
+
+//=================================================================================================================
+//======================================  Opérateurs                          =====================================
+//=================================================================================================================
+
+template<typename T> struct is_function : std::false_type {};
+template<> struct is_function<map_version::PiecewiseLinearFunction> : std::true_type {};
+template<> struct is_function<flat_version::PiecewiseLinearFunction> : std::true_type {};
+
+template<typename T, typename = void> struct is_node : std::false_type {};
+template<typename T> struct is_node<T, std::void_t<typename T::expr_node>>
+    : std::is_same<typename T::expr_node, T> {};
+
+// Une fonction devient une feuille, un noeud est gardé par valeur (il ne contient que des références)
+template<typename T>
+auto as_node(const T& t) {
+    if constexpr (is_function<T>::value) return Leaf<T>(t);
+    else return t;
+}
+
+template<typename T>
+constexpr bool is_operand = is_function<T>::value || is_node<T>::value;
+
+template<typename A, typename B, typename = std::enable_if_t<is_operand<A> && is_operand<B>>>
+auto operator+(const A& a, const B& b) {
+    auto l = as_node(a);
+    auto r = as_node(b);
+    static_assert(std::is_same<typename decltype(l)::function_type, typename decltype(r)::function_type>::value,
+                  "toutes les feuilles d'une expression doivent avoir le même type de fonction");
+    return Sum<decltype(l), decltype(r)>(l, r);
+}
+
+template<typename A, typename B, typename = std::enable_if_t<is_operand<A> && is_operand<B>>>
+auto operator-(const A& a, const B& b) {
+    auto l = as_node(a);
+    auto r = as_node(b);
+    static_assert(std::is_same<typename decltype(l)::function_type, typename decltype(r)::function_type>::value,
+                  "toutes les feuilles d'une expression doivent avoir le même type de fonction");
+    return Diff<decltype(l), decltype(r)>(l, r);
+}
+
+template<typename A, typename = std::enable_if_t<is_operand<A>>>
+auto operator*(double k, const A& a) {
+    auto e = as_node(a);
+    return Scale<decltype(e)>(e, k);
+}
+
+template<typename A, typename = std::enable_if_t<is_operand<A>>>
+auto operator*(const A& a, double k) {
+    return k * a;
+}
+
+template<typename A, typename = std::enable_if_t<is_operand<A>>>
+auto operator-(const A& a) {
+    return -1.0 * a;
+}
+
+}
+
+// Les opérateurs sont visibles par ADL sur les fonctions elles-mêmes
+namespace map_version {
+using expr::operator+;
+using expr::operator-;
+using expr::operator*;
+}
+
+namespace flat_version {
+using expr::operator+;
+using expr::operator-;
+using expr::operator*;
+}
+
+#endif
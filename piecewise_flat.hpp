@@ -0,0 +1,287 @@
+#ifndef PIECEWISE_FLAT_HPP
+#define PIECEWISE_FLAT_HPP
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <utility>
+#include <string>
+#include "piecewise_simd.hpp"
+#include "piecewise_text.hpp"
+
+namespace flat_version {
+
+const double EPSILON = 1e-6; // même tolérance que map_version
+class PiecewiseLinearFunction ;
+
+
+// Fonctions utilitaires pour construire des profils particuliers
+inline PiecewiseLinearFunction delta_profile(double gap, double a, double b, double c) ;
+inline PiecewiseLinearFunction cba_profile(double cap, double a, double b) ;
+inline PiecewiseLinearFunction negate(const PiecewiseLinearFunction& f) ;
+inline PiecewiseLinearFunction importFunction(const std::string& filename) ;
+
+// Stockage "structure of arrays" : abscisses et valeurs absolues f(x_i) dans deux tableaux contigus.
+// Même interface que map_version::PiecewiseLinearFunction (addBreakpoint prend toujours un deltaY),
+// mais les lectures (evaluate) sont des recherches dichotomiques et sum/export des fusions linéaires.
+class PiecewiseLinearFunction {
+
+
+private:
+    std::vector<double> xs;   // abscisses triées
+    std::vector<double> ys;   // valeurs absolues aux abscisses
+
+    // indice du premier breakpoint d'abscisse >= x
+    size_t lowerIndex(double x) const {
+        return static_cast<size_t>(std::lower_bound(xs.begin(), xs.end(), x) - xs.begin());
+    }
+
+    // valeur avant le breakpoint i (0 avant le premier point)
+    double valueBefore(size_t i) const {
+        return i == 0 ? 0.0 : ys[i - 1];
+    }
+
+    // décale toutes les valeurs à partir de l'indice i (les deltaY suivants sont conservés)
+    void shiftFrom(size_t i, double dy) {
+        if (dy == 0.0) return;
+        for (size_t k = i; k < ys.size(); ++k) ys[k] += dy;
+    }
+
+public:
+
+    PiecewiseLinearFunction(double y0 = 0.0) {
+        xs.push_back(0.0);
+        ys.push_back(y0);
+    }
+
+
+    void addBreakpoint(double x, double deltaY) {
+        size_t i = lowerIndex(x);
+        double y = valueBefore(i) + deltaY;
+        if (i < xs.size() && xs[i] == x) {
+            // remplacer le deltaY existant : tout ce qui suit est décalé de la différence
+            double old = ys[i];
+            ys[i] = y;
+            shiftFrom(i + 1, y - old);
+        } else {
+            xs.insert(xs.begin() + i, x);
+            ys.insert(ys.begin() + i, y);
+            shiftFrom(i + 1, deltaY);
+        }
+    }
+
+
+    void removeBreakpoint(double x) {
+        size_t i = lowerIndex(x);
+        if (i < xs.size() && xs[i] == x) {
+            double deltaY = ys[i] - valueBefore(i);
+            xs.erase(xs.begin() + i);
+            ys.erase(ys.begin() + i);
+            shiftFrom(i, -deltaY);
+        }
+    }
+
+    // Ajout en fin en valeur absolue (construction en bloc, x doit être croissant)
+    void push_back(double x, double y) {
+        xs.push_back(x);
+        ys.push_back(y);
+    }
+
+    void clear() {
+        xs.clear();
+        ys.clear();
+    }
+
+    void reserve(size_t n) {
+        xs.reserve(n);
+        ys.reserve(n);
+    }
+
+    size_t size() const { return xs.size(); }
+
+    const std::vector<double>& abscissas() const { return xs; }
+    const std::vector<double>& values() const { return ys; }
+
+    // Évalue la fonction en un point x (mêmes conventions que map_version::eval)
+    double evaluate(double x) const {
+        if (xs.empty() || x < xs.front()) {
+            return 0.0;
+        }
+
+        // premier breakpoint (après le premier) tel que x <= x_i + EPSILON
+        size_t i = simd::count_below(xs.data(), xs.size(), x, EPSILON);
+        return simd::interpolate_at(xs.data(), ys.data(), xs.size(), x, i);
+    }
+
+    // Évalue la fonction en count points : out[k] = evaluate(xs[k]), résultats identiques bit à bit
+    void evaluate_many(const double* qs, double* out, size_t count) const {
+        simd::interpolate_many(xs.data(), ys.data(), xs.size(), qs, out, count, EPSILON);
+    }
+
+    std::vector<double> evaluate_many(const std::vector<double>& qs) const {
+        std::vector<double> out(qs.size());
+        evaluate_many(qs.data(), out.data(), qs.size());
+        return out;
+    }
+
+//======================================================================================================
+//==========================              sum/minus f+g/f-g           ==================================
+//======================================================================================================
+
+// Addition de deux fonctions : fusion linéaire des deux tableaux triés.
+// Avant la fenêtre de g rien ne change, après la fenêtre on ajoute la dernière valeur de g.
+    void sum(const PiecewiseLinearFunction& g) {
+        if (g.xs.empty()) return;
+
+        double xg_min = g.xs.front();
+        double xg_max = g.xs.back();
+        double g_last = g.ys.back();
+
+        size_t lo = lowerIndex(xg_min);
+        size_t hi = static_cast<size_t>(std::upper_bound(xs.begin(), xs.end(), xg_max) - xs.begin());
+
+        std::vector<double> rx, ry;
+        rx.reserve(xs.size() + g.xs.size());
+        ry.reserve(xs.size() + g.xs.size());
+        rx.insert(rx.end(), xs.begin(), xs.begin() + lo);
+        ry.insert(ry.end(), ys.begin(), ys.begin() + lo);
+
+        size_t i = lo, j = 0;
+        while (i < hi || j < g.xs.size()) {
+            double x;
+            bool take_f = false, take_g = false;
+
+            if (j < g.xs.size() && (i == hi || g.xs[j] < xs[i])) {
+                x = g.xs[j];
+                take_g = true;
+            } else if (i < hi && (j == g.xs.size() || xs[i] < g.xs[j])) {
+                x = xs[i];
+                take_f = true;
+            } else { // même abscisse
+                x = xs[i];
+                take_f = take_g = true;
+            }
+
+            // F : point de f, 0 avant le premier point, constant après le dernier, sinon interpolation
+            double F;
+            if (take_f) {
+                F = ys[i];
+            } else if (i == 0) {
+                F = 0.0;
+            } else if (i == xs.size()) {
+                F = ys.back();
+            } else {
+                F = ys[i - 1] + (ys[i] - ys[i - 1]) * (x - xs[i - 1]) / (xs[i] - xs[i - 1]);
+            }
+
+            // G : point de g, sinon interpolation (x > xg_min ici)
+            double G;
+            if (take_g) {
+                G = g.ys[j];
+            } else {
+                G = g.ys[j - 1] + (g.ys[j] - g.ys[j - 1]) * (x - g.xs[j - 1]) / (g.xs[j] - g.xs[j - 1]);
+            }
+
+            rx.push_back(x);
+            ry.push_back(F + G);
+
+            if (take_f) ++i;
+            if (take_g) ++j;
+        }
+
+        for (size_t k = hi; k < xs.size(); ++k) {
+            rx.push_back(xs[k]);
+            ry.push_back(ys[k] + g_last);
+        }
+
+        xs.swap(rx);
+        ys.swap(ry);
+    }
+
+    // f -> -f
+    void negate() {
+        for (auto& y : ys) y = -y;
+    }
+
+
+//=================================================================================================================
+//======================================  utile pour print/draw python        =====================================
+//=================================================================================================================
+    // Exportation des points vers un fichier
+    void exportFunction(const std::string& filename) const {
+        text::Writer out(filename);
+        if (!out.ok()) {
+            std::cerr << "Erreur: impossible d'ouvrir le fichier " << filename << std::endl;
+            return;
+        }
+
+        for (size_t i = 0; i < xs.size(); ++i) {
+            out.point(xs[i], ys[i], ' ');
+        }
+
+        out.close();
+    }
+
+//======================================================================================================
+//======================================  Extract points (x,f(x))   =====================================
+//=======================================================================================================
+    std::vector<std::pair<double, double>> to_points_cumulative() const {
+        std::vector<std::pair<double, double>> points;
+        points.reserve(xs.size());
+        for (size_t i = 0; i < xs.size(); ++i) {
+            points.emplace_back(xs[i], ys[i]);
+        }
+        return points;
+    }
+
+};
+//=================================================================================================================
+//======================================  Construction profile delta function =====================================
+//=================================================================================================================
+
+inline PiecewiseLinearFunction delta_profile(double gap, double a, double b, double c) {
+    PiecewiseLinearFunction delta;
+    delta.addBreakpoint(a, 0);
+    delta.addBreakpoint(b, gap);
+    delta.addBreakpoint(c, -gap);
+    if(a>0.0){delta.removeBreakpoint(0.0);}
+    return delta;
+}
+
+inline PiecewiseLinearFunction cba_profile(double cap, double a, double b) {
+
+    PiecewiseLinearFunction cba;
+    cba.addBreakpoint(a, 0);
+    cba.addBreakpoint(b, cap);
+    if(a>0.0){cba.removeBreakpoint(0.0);}
+    return cba;
+}
+
+inline PiecewiseLinearFunction negate(const PiecewiseLinearFunction& f) {
+    PiecewiseLinearFunction result = f;
+    result.negate();
+    return result;
+}
+
+// Relecture d'un fichier écrit par exportFunction : points absolus à x strictement croissant
+inline PiecewiseLinearFunction importFunction(const std::string& filename) {
+    text::Reader in(filename);
+    PiecewiseLinearFunction f;
+    f.clear();
+
+    double x, y;
+    while (in.next(x, y)) {
+        if (f.size() > 0 && !(x > f.abscissas().back())) {
+            throw std::runtime_error(filename + " ligne " + std::to_string(in.lineNumber()) +
+                                     " : abscisses non croissantes");
+        }
+        f.push_back(x, y);
+    }
+    return f;
+}
+
+}
+
+#endif
@@ -13,30 +13,479 @@
 #include <fstream>
 #include <utility>
 #include <filesystem>
+#include <cstdint>
+#include <type_traits>
+#include <limits>
+#include "piecewise_simd.hpp"
+#include "piecewise_small.hpp"
+#include "piecewise_text.hpp"
+#include "piecewise_counters.hpp"
+#include "piecewise_trace.hpp"
 
 namespace map_version {
 
-const double EPSILON = 1e-6; // Utiliser une tolérance plus petite pour les comparaisons de double
-class PiecewiseLinearFunction ;
+constexpr double EPSILON = 1e-6; // Utiliser une tolérance plus petite pour les comparaisons de double
+
+// Comparaisons sur les abscisses selon leur type : tolérance EPSILON pour les doubles,
+// comparaisons exactes (et aucune tolérance) pour des instants entiers
+template<typename X>
+struct Coordinate {
+    static constexpr bool exact = std::is_integral<X>::value;
+    static constexpr double tolerance = exact ? 0.0 : EPSILON;
+
+    // x tombe sur le segment qui se termine en bound
+    static bool within(X x, X bound) {
+        if constexpr (exact) return x <= bound;
+        else return x <= bound + EPSILON;
+    }
+
+    // plus petite clé c telle que within(x, c)
+    static X lowest(X x) {
+        if constexpr (exact) return x;
+        else return x - EPSILON;
+    }
+};
+
+// argument non déduit : delta_profile(5, 10, 20, 30) reste en double
+template<typename T> struct identity { using type = T; };
+
+// Transformation affine paresseuse d'une fonction : la fonction lue vaut scale * f(x - shift) + offset
+// à partir de son premier breakpoint (0 avant, comme toujours ; offset s'ajoute donc au premier deltaY)
+template<typename X>
+struct Affine {
+    X shift = X(0);
+    double scale = 1.0;
+    double offset = 0.0;
+
+    bool identity() const { return shift == X(0) && scale == 1.0 && offset == 0.0; }
+};
+
+template<typename X> class BasicPiecewiseLinearFunction ;
+
+// Instanciation historique : abscisses double avec tolérance EPSILON
+using PiecewiseLinearFunction = BasicPiecewiseLinearFunction<double>;
+// Instants entiers : comparaisons exactes
+using IntPiecewiseLinearFunction = BasicPiecewiseLinearFunction<std::int64_t>;
 
 
 // Fonctions utilitaires pour construire des profils particuliers
-inline PiecewiseLinearFunction delta_profile(double gap, double a, double b, double c) ;
-inline PiecewiseLinearFunction cba_profile(double cap, double a, double b) ;
+template<typename X = double>
+BasicPiecewiseLinearFunction<X> delta_profile(double gap, typename identity<X>::type a,
+                                              typename identity<X>::type b, typename identity<X>::type c) ;
+template<typename X = double>
+BasicPiecewiseLinearFunction<X> cba_profile(double cap, typename identity<X>::type a,
+                                            typename identity<X>::type b) ;
+
+// Somme en une passe d'un ensemble de profils (contributions de tâches)
+template<typename X>
+BasicPiecewiseLinearFunction<X> sum_all(const BasicPiecewiseLinearFunction<X>* profiles, size_t count) ;
+template<typename X>
+BasicPiecewiseLinearFunction<X> sum_all(const std::vector<BasicPiecewiseLinearFunction<X>>& profiles) ;
+
+// Relecture d'un fichier écrit par exportFunction (ou "x,y"), construction en bloc
+inline PiecewiseLinearFunction importFunction(const std::string& filename) ;
 
 // Exporter cbamin et cbamax dans un seul fichier dans un dossier
 inline void exportFunc(const PiecewiseLinearFunction& cbamin,
         const PiecewiseLinearFunction& cbamax,
         const std::string& filename);
 
-class PiecewiseLinearFunction {
+//=================================================================================================================
+//======================================  Index des valeurs cumulées (treap)  =====================================
+//=================================================================================================================
+// Arbre binaire de recherche aléatoire (treap) indexé par x. Chaque noeud garde son deltaY
+// et la somme des deltaY de son sous-arbre : la valeur f(x_i) = somme des deltas des clés <= x_i
+// s'obtient en O(log n), et reste à jour en O(log n) à chaque insertion/suppression.
+//
+// Le résumé d'un sous-arbre (Range) porte aussi le nombre de clés, le maximum des valeurs
+// cumulées et l'aire sous la fonction entre sa première et sa dernière clé, relatifs à la valeur
+// avant le sous-arbre : deux résumés consécutifs se combinent en O(1) (join), ce qui donne les
+// requêtes d'intervalle (max, intégrale, comptage, premier dépassement) en O(log n).
+template<typename X>
+class PrefixIndex {
+public:
+    struct Range {
+        X lo, hi;           // première et dernière clé
+        double first;       // deltaY de la première clé
+        double sum;         // somme des deltaY
+        double peak;        // max des valeurs cumulées aux clés (depuis 0 avant lo)
+        double area;        // intégrale de ces valeurs entre lo et hi
+        uint32_t count;
+    };
+
+    // Résumé de a suivi de b (toutes les clés de a avant celles de b)
+    static Range join(const Range& a, const Range& b) {
+        double gap = static_cast<double>(b.lo - a.hi);
+        double width = static_cast<double>(b.hi - b.lo);
+        return {a.lo, b.hi, a.first, a.sum + b.sum, std::max(a.peak, a.sum + b.peak),
+                a.area + gap * (2.0 * a.sum + b.first) / 2.0 + b.area + a.sum * width,
+                a.count + b.count};
+    }
+
+    void clear() {
+        nodes.clear();
+        free_slots.clear();
+        root = NIL;
+    }
+
+    bool empty() const { return root == NIL; }
+
+    // Construction en O(n) depuis des breakpoints triés (arbre cartésien sur des priorités aléatoires)
+    void assign(const std::map<X, double>& breakpoints) {
+        clear();
+        nodes.reserve(breakpoints.size());
+        std::vector<int32_t> stack;
+        for (const auto& kv : breakpoints) {
+            int32_t t = newNode(kv.first, kv.second);
+            int32_t last = NIL;
+            while (!stack.empty() && nodes[stack.back()].prio < nodes[t].prio) {
+                last = stack.back();
+                stack.pop_back();
+                update(last);
+            }
+            nodes[t].left = last;
+            if (!stack.empty()) nodes[stack.back()].right = t;
+            stack.push_back(t);
+        }
+        while (!stack.empty()) {
+            update(stack.back());
+            root = stack.front();
+            stack.pop_back();
+        }
+    }
+
+    // Insère ou remplace le deltaY associé à x
+    void set(X x, double delta) { root = insert(root, x, delta); }
+
+    void erase(X x) { root = remove(root, x); }
+
+    // Somme des deltaY des clés <= x, c'est-à-dire f(x_i) si x = x_i est un breakpoint
+    double prefix(X x) const {
+        double acc = 0.0;
+        int32_t t = root;
+        while (t != NIL) {
+            const Node& n = nodes[t];
+            if (n.x <= x) {
+                acc += sum(n.left) + n.delta;
+                t = n.right;
+            } else {
+                t = n.left;
+            }
+        }
+        return acc;
+    }
+
+    // Somme de tous les deltaY (valeur après le dernier breakpoint)
+    double total() const { return sum(root); }
+
+    // Résumé des clés <= x (count == 0 s'il n'y en a aucune)
+    Range fold(X x) const {
+        Range acc{};
+        auto add = [&](const Range& r) { acc = acc.count == 0 ? r : join(acc, r); };
+        int32_t t = root;
+        while (t != NIL) {
+            const Node& n = nodes[t];
+            if (n.x <= x) {
+                if (n.left != NIL) add(nodes[n.left].agg);
+                add(own(n));
+                t = n.right;
+            } else {
+                t = n.left;
+            }
+        }
+        return acc;
+    }
+
+    // Nombre de clés <= x (inclusive) ou < x
+    size_t countUpTo(X x, bool inclusive) const {
+        size_t k = 0;
+        int32_t t = root;
+        while (t != NIL) {
+            const Node& n = nodes[t];
+            if (n.x < x || (inclusive && n.x == x)) {
+                k += count(n.left) + 1;
+                t = n.right;
+            } else {
+                t = n.left;
+            }
+        }
+        return k;
+    }
+
+    // Max des valeurs cumulées aux clés de [lo, hi] ; -infini s'il n'y en a aucune
+    double peak(X lo, X hi) const { return peak(root, lo, hi, 0.0); }
 
+    // Première clé > a dont la valeur cumulée dépasse strictement cap
+    bool firstAbove(X a, double cap, X& x, double& y) const { return firstAbove(root, a, cap, 0.0, x, y); }
+
+private:
+    static constexpr int32_t NIL = -1;
+
+    struct Node {
+        X x;
+        double delta;
+        uint32_t prio;
+        int32_t left, right;
+        Range agg;   // résumé du sous-arbre
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int32_t> free_slots;
+    int32_t root = NIL;
+    uint32_t seed = 0x9E3779B9u;
+
+    uint32_t nextPrio() {
+        // xorshift32 : suffisant pour équilibrer le treap
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    int32_t newNode(X x, double delta) {
+        Node n{x, delta, nextPrio(), NIL, NIL, {}};
+        n.agg = own(n);
+        if (!free_slots.empty()) {
+            int32_t t = free_slots.back();
+            free_slots.pop_back();
+            nodes[t] = n;
+            return t;
+        }
+        nodes.push_back(n);
+        return static_cast<int32_t>(nodes.size() - 1);
+    }
+
+    static Range own(const Node& n) { return {n.x, n.x, n.delta, n.delta, n.delta, 0.0, 1}; }
+
+    double sum(int32_t t) const { return t == NIL ? 0.0 : nodes[t].agg.sum; }
+
+    uint32_t count(int32_t t) const { return t == NIL ? 0 : nodes[t].agg.count; }
+
+    void update(int32_t t) {
+        Node& n = nodes[t];
+        n.agg = own(n);
+        if (n.left != NIL) n.agg = join(nodes[n.left].agg, n.agg);
+        if (n.right != NIL) n.agg = join(n.agg, nodes[n.right].agg);
+    }
+
+    // base : valeur cumulée avant le sous-arbre t
+    double peak(int32_t t, X lo, X hi, double base) const {
+        if (t == NIL) return -std::numeric_limits<double>::infinity();
+        const Node& n = nodes[t];
+        if (n.agg.hi < lo || n.agg.lo > hi) return -std::numeric_limits<double>::infinity();
+        if (lo <= n.agg.lo && n.agg.hi <= hi) return base + n.agg.peak;
+        double v = base + sum(n.left) + n.delta;
+        double best = peak(n.left, lo, hi, base);
+        if (lo <= n.x && n.x <= hi) best = std::max(best, v);
+        return std::max(best, peak(n.right, lo, hi, v));
+    }
+
+    // Les sous-arbres entièrement <= a ou sans valeur > cap sont écartés en O(1) : un seul chemin
+    // partiel (celui de a), puis une descente vers la réponse
+    bool firstAbove(int32_t t, X a, double cap, double base, X& x, double& y) const {
+        if (t == NIL) return false;
+        const Node& n = nodes[t];
+        if (n.agg.hi <= a || base + n.agg.peak <= cap) return false;
+        if (firstAbove(n.left, a, cap, base, x, y)) return true;
+        double v = base + sum(n.left) + n.delta;
+        if (n.x > a && v > cap) {
+            x = n.x;
+            y = v;
+            return true;
+        }
+        return firstAbove(n.right, a, cap, v, x, y);
+    }
+
+    int32_t rotateRight(int32_t t) {
+        int32_t l = nodes[t].left;
+        nodes[t].left = nodes[l].right;
+        nodes[l].right = t;
+        update(t);
+        update(l);
+        return l;
+    }
+
+    int32_t rotateLeft(int32_t t) {
+        int32_t r = nodes[t].right;
+        nodes[t].right = nodes[r].left;
+        nodes[r].left = t;
+        update(t);
+        update(r);
+        return r;
+    }
+
+    int32_t insert(int32_t t, X x, double delta) {
+        if (t == NIL) return newNode(x, delta);
+        if (x == nodes[t].x) {
+            nodes[t].delta = delta;
+        } else if (x < nodes[t].x) {
+            int32_t l = insert(nodes[t].left, x, delta);
+            nodes[t].left = l;
+            if (nodes[l].prio > nodes[t].prio) return rotateRight(t);
+        } else {
+            int32_t r = insert(nodes[t].right, x, delta);
+            nodes[t].right = r;
+            if (nodes[r].prio > nodes[t].prio) return rotateLeft(t);
+        }
+        update(t);
+        return t;
+    }
+
+    int32_t remove(int32_t t, X x) {
+        if (t == NIL) return NIL;
+        if (x < nodes[t].x) {
+            nodes[t].left = remove(nodes[t].left, x);
+        } else if (x > nodes[t].x) {
+            nodes[t].right = remove(nodes[t].right, x);
+        } else {
+            int32_t l = nodes[t].left, r = nodes[t].right;
+            if (l == NIL || r == NIL) {
+                free_slots.push_back(t);
+                return l == NIL ? r : l;
+            }
+            // descendre le noeud vers une feuille en conservant l'ordre de tas
+            if (nodes[l].prio > nodes[r].prio) {
+                t = rotateRight(t);
+                nodes[t].right = remove(nodes[t].right, x);
+            } else {
+                t = rotateLeft(t);
+                nodes[t].left = remove(nodes[t].left, x);
+            }
+        }
+        update(t);
+        return t;
+    }
+};
+
+// X : type des abscisses (double, ou entier pour des instants entiers comparés exactement).
+// Les valeurs restent des double.
+template<typename X>
+class BasicPiecewiseLinearFunction {
+
+    template<typename Y>
+    friend BasicPiecewiseLinearFunction<Y> sum_all(const BasicPiecewiseLinearFunction<Y>* profiles, size_t count);
+
+    using PiecewiseLinearFunction = BasicPiecewiseLinearFunction<X>;
+    using Map = std::map<X, double>;
 
 private:
     // map où la clé est l'abscisse (x) et la valeur est le deltaY
-    std::map<double, double> breakpoints;
+    Map breakpoints;
+
+    // Mode indexé : valeurs cumulées maintenues dans un treap pour une évaluation en O(log n)
+    bool indexed = false;
+    PrefixIndex<X> index;
+
+    // Trail : ancien état de chaque breakpoint modifié depuis le premier checkpoint,
+    // pour annuler en O(k) les k écritures faites depuis un checkpoint (retour arrière)
+    struct TrailEntry {
+        X x;
+        double old_delta;
+        bool existed;   // false : le point a été créé, l'annulation le supprime
+    };
+    bool trailing = false;
+    std::vector<TrailEntry> trail;
+
+    // Compaction automatique de la fenêtre modifiée par chaque sum
+    bool auto_compact = false;
+    size_t compacted = 0;   // points retirés par la compaction automatique
+
+    // Décalage/échelle/translation appliqués à la lecture (evaluate, parcours, export, sum de g) ;
+    // les breakpoints ne sont réécrits (materialize) qu'avant une modification structurelle
+    Affine<X> tag;
+
+#if defined(PIECEWISE_TRACE)
+    trace::Identity traced;   // numéro et état du profil dans une trace (piecewise_trace.hpp)
+#endif
+
+    const PrefixIndex<X>& rangeIndex(PrefixIndex<X>& scratch) const {
+        if (indexed) return index;
+        scratch.assign(breakpoints);
+        return scratch;
+    }
 
-    double eval(double x) const {
+    // Intégrale de f de -infini à x (f vaut 0 avant le premier breakpoint)
+    double areaUpTo(const PrefixIndex<X>& idx, X x) const {
+        auto r = idx.fold(x);
+        if (r.count == 0) return 0.0;
+        // de la dernière clé <= x jusqu'à x, f est linéaire
+        return r.area + (r.sum + evalRaw(x)) / 2.0 * static_cast<double>(x - r.hi);
+    }
+
+    // Valeur des breakpoints stockés, sans le tag
+    double evalRaw(X x) const {
+        return indexed ? evalIndexed(x) : eval(x);
+    }
+
+    // Valeur lue à partir de la valeur stockée en x_raw = x - shift
+    double applyTag(X x_raw, double raw) const {
+        if (breakpoints.empty() || x_raw < breakpoints.begin()->first) return 0.0;
+        return tag.scale * raw + tag.offset;
+    }
+
+    // Copie sans tag, pour les requêtes qu'une échelle négative retourne (max -> min)
+    PiecewiseLinearFunction materialized() const {
+        PiecewiseLinearFunction f = *this;
+        f.materialize();
+        return f;
+    }
+
+    // Toutes les écritures dans breakpoints passent par ces fonctions pour garder l'index,
+    // le trail et l'état tracé à jour
+    void setDelta(X x, double deltaY) {
+        PWL_TRACE_TOUCH();
+        auto [it, inserted] = breakpoints.try_emplace(x, deltaY);
+        if (inserted) PWL_COUNT(map_node_allocs, 1);
+        if (trailing) trail.push_back({x, inserted ? 0.0 : it->second, !inserted});
+        if (!inserted) it->second = deltaY;
+        if (indexed) index.set(x, deltaY);
+    }
+
+    void writeDelta(typename Map::iterator it, double deltaY) {
+        PWL_TRACE_TOUCH();
+        if (trailing) trail.push_back({it->first, it->second, true});
+        it->second = deltaY;
+        if (indexed) index.set(it->first, deltaY);
+    }
+
+    void eraseDelta(typename Map::iterator it) {
+        PWL_TRACE_TOUCH();
+        PWL_COUNT(map_node_frees, 1);
+        if (trailing) trail.push_back({it->first, it->second, true});
+        if (indexed) index.erase(it->first);
+        breakpoints.erase(it);
+    }
+
+    // Évaluation en O(log n) : même intervalle que eval(), mais y_prev est lu dans l'index
+    double evalIndexed(X x) const {
+        PWL_COUNT(eval_calls, 1);
+        if (breakpoints.empty()) {
+            return 0.0;
+        }
+
+        auto first = breakpoints.begin();
+        if (x < first->first) {
+            return 0.0;
+        }
+
+        // premier breakpoint (après le premier) tel que x <= x_curr + EPSILON
+        auto it = breakpoints.lower_bound(Coordinate<X>::lowest(x));
+        PWL_COUNT(map_lookups, 1);
+        if (it == first) ++it;
+        if (it == breakpoints.end()) {
+            return index.total();
+        }
+
+        auto prev_it = std::prev(it);
+        X x_prev = prev_it->first;
+        double y_prev = index.prefix(x_prev);
+        double y_curr = y_prev + it->second;
+        double slope = (y_curr - y_prev) / static_cast<double>(it->first - x_prev);
+        return y_prev + slope * static_cast<double>(x - x_prev);
+    }
+
+    double eval(X x) const {
+        PWL_COUNT(eval_calls, 1);
         if (breakpoints.empty()) {
             return 0.0;
         }
@@ -44,7 +493,7 @@ private:
      
         auto prev_it = breakpoints.begin();
         double y_prev = prev_it->second;   // valeur au premier breakpoint
-        double x_prev = prev_it->first;
+        X x_prev = prev_it->first;
     
         // Cas particulier : si x < premier point
         if (x < x_prev) {
@@ -53,14 +502,15 @@ private:
     
         // Accumuler et trouver l’intervalle où se situe x
         for (auto it = std::next(breakpoints.begin()); it != breakpoints.end(); ++it) {
-            double x_curr = it->first;
+            X x_curr = it->first;
             double delta = it->second;
             double y_curr = y_prev + delta;
+            PWL_COUNT(eval_scan, 1);
     
-            if (x <= x_curr + EPSILON) {
+            if (Coordinate<X>::within(x, x_curr)) {
                 // interpolation entre (x_prev, y_prev) et (x_curr, y_curr)
-                double slope = (y_curr - y_prev) / (x_curr - x_prev);
-                return y_prev + slope * (x - x_prev);
+                double slope = (y_curr - y_prev) / static_cast<double>(x_curr - x_prev);
+                return y_prev + slope * static_cast<double>(x - x_prev);
             }
     
             // avancer
@@ -74,65 +524,384 @@ private:
     
 public:
 
-    PiecewiseLinearFunction(double y0 = 0.0) {
-              breakpoints[0.0] = y0;
+    BasicPiecewiseLinearFunction(double y0 = 0.0) {
+              breakpoints[X(0)] = y0;
             
         }
     
 
-    void addBreakpoint(double x, double deltaY) {
+    void addBreakpoint(X x, double deltaY) {
+        PWL_TRACE_CALL();
+        PWL_TRACE(add, *this, static_cast<double>(x), deltaY);
+        materialize();
         // Ajouter à la valeur existante si le point de rupture existe
-        breakpoints[x] = deltaY;
+        setDelta(x, deltaY);
     }
 
 
-    void removeBreakpoint(double x) {
+    void removeBreakpoint(X x) {
+        PWL_TRACE_CALL();
+        PWL_TRACE(remove, *this, static_cast<double>(x));
+        materialize();
         auto it = breakpoints.find(x);
+        PWL_COUNT(map_lookups, 1);
         if (it != breakpoints.end()) {
-            breakpoints.erase(it);
+            eraseDelta(it);
+        }
+    }
+
+    // Ajout en fin (x strictement supérieur au dernier breakpoint) : O(1) amorti.
+    // Un x déjà présent repasse par setDelta pour que le trail garde l'ancien delta.
+    void appendBreakpoint(X x, double deltaY) {
+        materialize();
+        size_t before = breakpoints.size();
+        auto it = breakpoints.emplace_hint(breakpoints.end(), x, deltaY);
+        if (breakpoints.size() == before) {
+            setDelta(it->first, deltaY);
+            return;
         }
+        PWL_TRACE_TOUCH();
+        PWL_COUNT(map_node_allocs, 1);
+        if (trailing) trail.push_back({x, 0.0, false});
+        if (indexed) index.set(x, deltaY);
+    }
+
+    // Supprime tous les breakpoints (la fonction vaut alors 0 partout)
+    void clear() {
+        tag = Affine<X>();
+        assignPoints({});
     }
 
     // Évalue la fonction en un point x
-    double evaluate(double x) const {
-        return eval(x);
+    double evaluate(X x) const {
+        PWL_TRACE_CALL();
+        PWL_TRACE(evaluate, *this, static_cast<double>(x));
+        if (tag.identity()) return evalRaw(x);
+        return applyTag(x - tag.shift, evalRaw(x - tag.shift));
+    }
+
+//======================================================================================================
+//==========================        Transformations affines paresseuses    ============================
+//======================================================================================================
+// shift/scale/offset ne modifient que le tag : O(1). Les lectures appliquent le tag à la volée,
+// les modifications structurelles (add/remove/append, sum, min/max, compaction) appellent
+// d'abord materialize(), qui réécrit les breakpoints en O(n). Pendant un checkpoint, le tag est
+// appliqué tout de suite pour que restore() puisse l'annuler comme une autre écriture.
+
+    // f(x) devient f(x - dx)
+    void shift(X dx) {
+        PWL_TRACE_TOUCH();
+        tag.shift += dx;
+        if (trailing) materialize();
+    }
+
+    // f devient factor * f
+    void scale(double factor) {
+        PWL_TRACE_TOUCH();
+        tag.scale *= factor;
+        tag.offset *= factor;
+        if (trailing) materialize();
+    }
+
+    // f devient f + c à partir de son premier breakpoint
+    void offset(double c) {
+        PWL_TRACE_TOUCH();
+        tag.offset += c;
+        if (trailing) materialize();
+    }
+
+    const Affine<X>& transform() const { return tag; }
+    bool isTransformed() const { return !tag.identity(); }
+
+    // Réécrit les breakpoints avec le tag appliqué, puis l'oublie
+    void materialize() {
+        if (tag.identity()) return;
+        auto points = to_points_cumulative();
+        tag = Affine<X>();
+        assignPoints(points);
+    }
+
+    // Évalue la fonction en count points : out[k] = evaluate(xs[k]), résultats identiques bit à bit.
+    // Les valeurs cumulées sont calculées une fois (même ordre d'addition que eval), puis les
+    // requêtes passent par les noyaux de piecewise_simd.hpp (fusion si triées, dichotomie sinon).
+    // (pour des abscisses entières, les requêtes sont des instants entiers écrits en double)
+    void evaluate_many(const double* xs, double* out, size_t count) const {
+        PWL_TRACE_CALL();
+        PWL_TRACE(evaluateMany, *this, xs, count);
+        if (!tag.identity()) {
+            std::vector<double> shifted(xs, xs + count);
+            for (double& x : shifted) x -= static_cast<double>(tag.shift);
+            evaluateManyRaw(shifted.data(), out, count);
+            for (size_t k = 0; k < count; ++k) out[k] = applyTag(static_cast<X>(shifted[k]), out[k]);
+            return;
+        }
+        evaluateManyRaw(xs, out, count);
+    }
+
+    std::vector<double> evaluate_many(const std::vector<double>& xs) const {
+        std::vector<double> out(xs.size());
+        evaluate_many(xs.data(), out.data(), xs.size());
+        return out;
+    }
+
+private:
+    void evaluateManyRaw(const double* xs, double* out, size_t count) const {
+        if (indexed) {
+            for (size_t k = 0; k < count; ++k) out[k] = evalIndexed(static_cast<X>(xs[k]));
+            return;
+        }
+
+        std::vector<double> bx, by;
+        bx.reserve(breakpoints.size());
+        by.reserve(breakpoints.size());
+        double y = 0.0;
+        for (const auto& kv : breakpoints) {
+            y += kv.second;
+            bx.push_back(static_cast<double>(kv.first));
+            by.push_back(y);
+        }
+        simd::interpolate_many(bx.data(), by.data(), bx.size(), xs, out, count, Coordinate<X>::tolerance);
+    }
+
+public:
+
+    // Active/désactive l'index des valeurs cumulées (construction en O(n))
+    void enableIndex() {
+        if (indexed) return;
+        index.assign(breakpoints);
+        indexed = true;
+    }
+
+    void disableIndex() {
+        indexed = false;
+        index.clear();
+    }
+
+    bool isIndexed() const { return indexed; }
+
+    // Point de retour : active l'enregistrement des modifications et renvoie la position du trail
+    size_t checkpoint() {
+        materialize();
+        trailing = true;
+        return trail.size();
+    }
+
+    // Annule toutes les modifications faites depuis le checkpoint, en ordre inverse
+    void restore(size_t mark) {
+        bool was_trailing = trailing;
+        trailing = false;
+        while (trail.size() > mark) {
+            TrailEntry e = trail.back();
+            trail.pop_back();
+            if (e.existed) {
+                setDelta(e.x, e.old_delta);
+            } else {
+                auto it = breakpoints.find(e.x);
+                if (it != breakpoints.end()) eraseDelta(it);
+            }
+        }
+        trailing = was_trailing;
+    }
+
+    // Conserve l'état courant : vide le trail et arrête l'enregistrement
+    void discardTrail() {
+        trailing = false;
+        trail.clear();
+    }
+
+    size_t trailSize() const { return trail.size(); }
+
+//======================================================================================================
+//==========================           Requêtes sur un intervalle      =================================
+//======================================================================================================
+// En mode indexé (enableIndex), O(log n) par requête, et les résultats suivent addBreakpoint/sum
+// puisque toutes les écritures passent par l'index. Sans index, un index temporaire est construit
+// (O(n)) : à réserver aux appels isolés.
+// Un tag d'échelle positive ou nulle est appliqué au résultat ; une échelle négative échange max
+// et min, la requête passe alors par une copie matérialisée.
+
+    // Nombre de breakpoints dans [a, b]
+    size_t countBreakpoints(X a, X b) const {
+        if (b < a) return 0;
+        PrefixIndex<X> scratch;
+        const PrefixIndex<X>& idx = rangeIndex(scratch);
+        return idx.countUpTo(b - tag.shift, true) - idx.countUpTo(a - tag.shift, false);
+    }
+
+    // max de f sur [a, b] (f est linéaire entre deux breakpoints : bornes et breakpoints suffisent)
+    double maxOver(X a, X b) const {
+        if (tag.scale < 0.0) return materialized().maxOver(a, b);
+        PrefixIndex<X> scratch;
+        double best = std::max(evaluate(a), evaluate(b));
+        double peak = rangeIndex(scratch).peak(a - tag.shift, b - tag.shift);
+        if (peak == -std::numeric_limits<double>::infinity()) return best;
+        return std::max(best, tag.scale * peak + tag.offset);
+    }
+
+    // Intégrale de f sur [a, b]
+    double integral(X a, X b) const {
+        PrefixIndex<X> scratch;
+        const PrefixIndex<X>& idx = rangeIndex(scratch);
+        X ra = a - tag.shift, rb = b - tag.shift;
+        double area = areaUpTo(idx, rb) - areaUpTo(idx, ra);
+        if (tag.identity()) return area;
+        // offset compté à partir du premier breakpoint
+        double covered = 0.0;
+        if (!breakpoints.empty()) {
+            X first = breakpoints.begin()->first;
+            covered = static_cast<double>(std::max(rb, first) - std::max(ra, first));
+        }
+        return tag.scale * area + tag.offset * covered;
+    }
+
+    // Premier x >= a où f dépasse cap : a si f(a) > cap, sinon le point où f franchit cap (f y vaut
+    // cap et le dépasse juste après, ou y saute au premier breakpoint) ; +infini si f <= cap après a
+    double firstAbove(X a, double cap) const {
+        if (evaluate(a) > cap) return static_cast<double>(a);
+        if (tag.identity()) return firstAboveRaw(a, cap);
+        if (tag.scale < 0.0) return materialized().firstAbove(a, cap);
+        if (breakpoints.empty()) return std::numeric_limits<double>::infinity();
+
+        // avant le premier breakpoint f vaut 0 <= cap : la recherche commence au premier point
+        X ra = std::max(a - tag.shift, breakpoints.begin()->first);
+        double shift = static_cast<double>(tag.shift);
+        if (tag.scale == 0.0) return tag.offset > cap ? static_cast<double>(ra) + shift : std::numeric_limits<double>::infinity();
+        return firstAboveRaw(ra, (cap - tag.offset) / tag.scale) + shift;
+    }
+
+    size_t size() const { return breakpoints.size(); }
+
+    // Parcours en lecture des breakpoints (x, deltaY) dans l'ordre croissant, tag appliqué.
+    // Les points sont des valeurs (it->first, it->second), comme binary::DeltaIterator.
+    class const_iterator {
+    public:
+        struct Point {
+            X first;
+            double second;
+            const Point* operator->() const { return this; }
+        };
+
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = Point;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Point;
+        using reference = Point;
+
+        const_iterator() = default;
+        const_iterator(typename Map::const_iterator it, const BasicPiecewiseLinearFunction* f) : it(it), f(f) {}
+
+        Point operator*() const {
+            const Affine<X>& t = f->tag;
+            double delta = t.scale * it->second;
+            if (it == f->breakpoints.begin()) delta += t.offset;
+            return {it->first + t.shift, delta};
+        }
+        Point operator->() const { return **this; }
+        const_iterator& operator++() { ++it; return *this; }
+        const_iterator& operator--() { --it; return *this; }
+        bool operator==(const const_iterator& o) const { return it == o.it; }
+        bool operator!=(const const_iterator& o) const { return it != o.it; }
+
+    private:
+        typename Map::const_iterator it;
+        const BasicPiecewiseLinearFunction* f = nullptr;
+    };
+
+    const_iterator begin() const { return {breakpoints.begin(), this}; }
+    const_iterator end() const { return {breakpoints.end(), this}; }
+
+    // Premier breakpoint d'abscisse >= x
+    const_iterator lowerBound(X x) const {
+        PWL_COUNT(map_lookups, 1);
+        return {breakpoints.lower_bound(x - tag.shift), this};
     }
 
+private:
+    // firstAbove sur les breakpoints stockés (a et le résultat sans décalage)
+    double firstAboveRaw(X a, double cap) const {
+        if (evalRaw(a) > cap) return static_cast<double>(a);
+        PrefixIndex<X> scratch;
+        X xi;
+        double yi;
+        if (!rangeIndex(scratch).firstAbove(a, cap, xi, yi)) return std::numeric_limits<double>::infinity();
+
+        auto it = breakpoints.find(xi);
+        PWL_COUNT(map_lookups, 1);
+        if (it == breakpoints.begin()) return static_cast<double>(xi);   // saut depuis 0
+        X x0 = std::prev(it)->first;
+        double y0 = yi - it->second;
+        if (x0 < a) {
+            x0 = a;
+            y0 = evalRaw(a);
+        }
+        return static_cast<double>(x0) + (cap - y0) / (yi - y0) * static_cast<double>(xi - x0);
+    }
+
+public:
+
 //======================================================================================================
 //==========================              sum/minus f+g/f-g           ==================================
 //======================================================================================================
 
 // Addition de deux fonctions
+// Balayage unique de la fenêtre [xg_min, xg_max] : on transporte les valeurs de f et de g
+// relativement au dernier point de f avant la fenêtre (les deltaY étant des différences, la valeur
+// absolue de f n'est jamais nécessaire). Coût O(k + taille de la fenêtre), indépendant de |f|.
     void sum(const PiecewiseLinearFunction& g) {
-        if (g.breakpoints.empty()) return;
+        PWL_TRACE_CALL();
+        PWL_TRACE(sum, *this, g.traced, g);
+        if (g.tag.identity()) sumPoints(g.breakpoints.begin(), g.breakpoints.end());
+        else sumPoints(g.begin(), g.end());   // g décalé/mis à l'échelle : lu à travers son tag
+    }
+
+    // Profil de tâche sur la pile : même balayage, sans construire de map pour g
+    template<size_t N>
+    void sum(const small_version::SmallPiecewise<N>& g) {
+        sumPoints(g.begin(), g.end());
+    }
+
+    // g donné par ses breakpoints (x, deltaY) croissants : map, tableau ou profil projeté en
+    // mémoire (piecewise_binary.hpp) ; It expose ->first / ->second et se parcourt dans les deux sens
+    template<typename It>
+    void sumPoints(It g_begin, It g_end) {
+        PWL_TRACE_CALL();
+        PWL_TRACE(sumPoints, *this, g_begin, g_end);
+        if (g_begin == g_end) return;
+        PWL_COUNT(sum_calls, 1);
+        materialize();
     
-        double xg_min = g.breakpoints.begin()->first;
-        double xg_max = g.breakpoints.rbegin()->first;
-        double yi_prec = 0.0;
+        X xg_min = static_cast<X>(g_begin->first);
+        X xg_max = static_cast<X>(std::prev(g_end)->first);
     
-        // bornes utiles de f
-        auto it_f = breakpoints.upper_bound(xg_min);
+        // bornes utiles de f : points dans [xg_min, xg_max]
+        auto it_f = breakpoints.lower_bound(xg_min);
         auto end_f = breakpoints.upper_bound(xg_max);
-    
-        auto it_g = g.breakpoints.begin();
+        PWL_COUNT(map_lookups, 2);
+        It it_g = g_begin;
 
-        if (it_f != breakpoints.begin()) {
-            auto prev = it_f;   // copie
-            --prev;           // recule d'un cran
-            yi_prec = this->eval(prev->first);
-        }
-    
+        // état de f : dernier point de f déjà vu (valeur relative au point avant la fenêtre)
+        bool has_prev_f = (it_f != breakpoints.begin());
+        X xf_prev = has_prev_f ? std::prev(it_f)->first : X(0);
+        double yf_prev = 0.0;
+
+        // état de g : valeur absolue (g vaut 0 avant son premier point)
+        X xg_prev = xg_min;
+        double yg_prev = 0.0;
+
+        // valeur (relative) de f+g au dernier point écrit
+        double yi_prec = 0.0;
     
-        while (it_f != end_f || it_g != g.breakpoints.end()) {
-            double x;
+        while (it_f != end_f || it_g != g_end) {
+            X x;
             bool take_f = false, take_g = false;
+            PWL_COUNT(sum_merge_steps, 1);
     
-            if (it_g != g.breakpoints.end() &&
+            if (it_g != g_end &&
                 (it_f == end_f || it_g->first < it_f->first)) {
-                x = it_g->first;
+                x = static_cast<X>(it_g->first);
                 take_g = true;
             } else if (it_f != end_f &&
-                       (it_g == g.breakpoints.end() || it_f->first < it_g->first)) {
+                       (it_g == g_end || it_f->first < it_g->first)) {
                 x = it_f->first;
                 take_f = true;
             } else { // même abscisse
@@ -140,287 +909,337 @@ public:
                 take_f = take_g = true;
             }
     
-            double F = this->eval(x);
-            double G = g.eval(x);
+            // F : point de f, ou interpolation sur le segment de f qui contient x
+            double F;
+            if (take_f) {
+                F = yf_prev + it_f->second;
+            } else if (!has_prev_f || it_f == breakpoints.end()) {
+                F = yf_prev;
+            } else {
+                F = yf_prev + it_f->second * (x - xf_prev) / (it_f->first - xf_prev);
+            }
+
+            // G : point de g, ou interpolation entre deux points de g (x > xg_min ici)
+            double G;
+            if (take_g) {
+                G = yg_prev + it_g->second;
+            } else {
+                G = yg_prev + it_g->second * (x - xg_prev) / (it_g->first - xg_prev);
+            }
+
             double sum = F + G;
             double delta_sum = sum - yi_prec;
             yi_prec = sum;
     
-
-            // déjà un point à x ?
-            auto it_match = breakpoints.find(x);
-            if (it_match != breakpoints.end()) {
-                it_match->second = delta_sum;
+            if (take_f) {
+                writeDelta(it_f, delta_sum);
+                xf_prev = x;
+                yf_prev = F;
+                has_prev_f = true;
+                ++it_f;
             } else {
-                breakpoints[x] = delta_sum;
+                setDelta(x, delta_sum);
+            }
+            if (take_g) {
+                xg_prev = x;
+                yg_prev = G;
+                ++it_g;
             }
-    
-            if (take_f) ++it_f;
-            if (take_g) ++it_g;
         }
+
+        // premier point de f après la fenêtre : son segment a pu être coupé en xg_max
+        if (it_f != breakpoints.end()) {
+            double F = yf_prev + it_f->second;
+            writeDelta(it_f, F + yg_prev - yi_prec);
+        }
+
+        if (auto_compact) compacted += compactWindow(xg_min, xg_max);
     }
     
 
 
     
-// //======================================================================================================
-// //====================================== min(f, constante c) and max  ==================================
-// //======================================================================================================
-//     void minfunction(double c) {
-//         std::cout << "--- minfunction start ---" << std::endl;
-    
-//         if (breakpoints.empty()) return;
-        
-//         //  Premier élément
-//         auto it_prev = breakpoints.begin();
-//         double x_prev = it_prev->first;
-
-//         double y_prev_old = it_prev->second;
-//         double y_prev = std::min(y_prev_old, c); // tronquer au besoin
-//         it_prev->second = y_prev;
-        
-//         std::cout << "First node: x=" << x_prev << ", y=" << y_prev_old << std::endl;
-        
-//         //  Élément suivant
-//         auto it_current = std::next(it_prev);
-//         if (it_current != breakpoints.end()) {
-//             double x_current = it_current->first;
-//             double y_current = y_prev_old + it_current->second;
-        
-//             bool prevAbove = y_prev_old > c;
-//             bool currUnder = y_current < c;
-        
-//             std::cout << "Visiting first segment: x_current=" << x_current
-//                       << ", y_current=" << y_current << std::endl;
-        
-//             // Traversée de c ?
-//             if (prevAbove && currUnder) {
-//                 //std::cout << "Crossing found in first segment" << std::endl;
-//                 // Interpolation pour trouver xi
-//                 double t = (c - y_prev_old) / (y_current - y_prev_old);
-//                 double xi = x_prev + t * (x_current - x_prev);
-        
-//                 // Ajouter breakpoint à xi avec delta 0
-//                 double deltaAtXi = 0;
-//                 breakpoints[xi] = deltaAtXi;
-//                 //std::cout << "Insert breakpoint at xi=" << xi << ", delta=" << deltaAtXi << std::endl;
-        
-//                 // Ajuster delta du point actuel
-//                 double remainingDelta = y_current - c;
-//                 it_current->second = remainingDelta;
-//                 //std::cout << "Adjust current delta: x=" << x_current
-//                         //   << ", remainingDelta=" << remainingDelta << std::endl;
-        
-//             } else {
-
-//                 if(c < y_prev_old){
-//                                     // Pas de coupure, ajuster delta
-//                 double newDelta = y_current - y_prev ;
-//                 it_current->second = newDelta;
-//                 // std::cout << "No crossing zero above c, adjust delta: x=" << x_current
-//                 //           << ", newDelta=" << newDelta << std::endl;
-                    
-//                 }else{
-//                 // Pas de coupure, ajuster delta
-//                 double newDelta = y_current - y_prev_old;
-//                 it_current->second = newDelta;
-//                 // std::cout << "No crossing, adjust delta: x=" << x_current
-//                 //           << ", newDelta=" << newDelta << std::endl;
-//                 }
-//             }
-//         } else {
-//             // std::cout << "No element after first node" << std::endl;
-//         }
-        
-
-
-
-//         std::vector<std::pair<double, double>> points;
-//         double y = 0.0;
-//         for (auto &kv : breakpoints) {
-//             y += kv.second;
-//             points.push_back({kv.first, y});
-//           //  std::cout << "Accumulated point: x=" << kv.first << ", y=" << y << std::endl;
-//         }
-    
-//         // Appliquer min avec c
-//         for (size_t i = 0; i < points.size() - 1; ++i) {
-//             double x = points[i + 1].first;
-//             double y_val = points[i + 1].second;
-    
-//             double y_prev = points[i].second;
-//             double x_prev = points[i].first;
-    
-//             bool prevAbove = y_prev > c;
-//             bool currAbove = y_val > c ;
-//             bool prevUnder = y_prev < c;
-//             bool currUnder = y_val < c ;
-    
-//             // std::cout << "\nVisiting segment: [" << x_prev << ", " << x << "] "
-//             //           << "y_prev=" << y_prev << ", y_curr=" << y_val << std::endl;
-    
-//             // Cas où on traverse la ligne y=c
-//             if ((prevAbove && currUnder) || (prevUnder && currAbove)) {
-//                 double t = (c - y_prev) / (y_val - y_prev);
-//                 double xi = x_prev + t * (x - x_prev);
-//                 double deltaAtXi = (y_prev >= c) ? 0 : c - y_prev;
-    
-//                 // std::cout << "Crossing found at x=" << xi << ", deltaAtXi=" << deltaAtXi << std::endl;
-//                 this->addBreakpoint(xi, deltaAtXi);
-    
-//                 if (prevAbove && currUnder) {
-//                     double remainingDelta = y_val - c;
-//                     breakpoints[x] = remainingDelta;
-//                     points[i + 1].second = c + remainingDelta;
-//                     // std::cout << "Adjusting current delta: x=" << x << ", remainingDelta=" << remainingDelta << std::endl;
-//                 }
-//             }
-    
-//             // Cas où le point tombe exactement sur c
-//             if (prevAbove && y_val == c) {
-//                 // std::cout << "Breakpoint exactly at c at x =" << x << std::endl;
-//                 breakpoints[x] = 0;
-//                 points[i + 1].second = c;
-//             }
-    
-//             // Supprimer les nœuds au-dessus de c
-//             if (y_val > c) {
-//                 // std::cout << "Deleting node above c: x=" << x << ", y=" << y_val << std::endl;
-//                 breakpoints.erase(x);
-//             }
-//         }
-    
-//         std::cout << "--- minfunction end ---" << std::endl;
-//     }
-    
+//======================================================================================================
+//====================================== min(f, constante c) and max  ==================================
+//======================================================================================================
+// Un seul passage sur les valeurs cumulées : chaque point est tronqué, les croisements avec y = c
+// sont insérés au fil de l'eau et les points strictement au-delà de c (hors premier) disparaissent,
+// le palier à c étant porté par les points de croisement. Réécriture en O(n) via assignPoints.
+    void minfunction(double c) {
+        clampConstant(c, true);
+    }
 
-//     void maxfunction(double c) {
-//         std::cout << "--- maxfunction start ---" << std::endl;
-    
-//         if (breakpoints.empty()) return;
-    
-//         //  Premier élément
-//         auto it_prev = breakpoints.begin();
-//         double x_prev = it_prev->first;
-//         double y_prev_old = it_prev->second;
-//         double y_prev = std::max(y_prev_old, c); // relever au besoin
-//         it_prev->second = y_prev;
-    
-//         std::cout << "First node: x=" << x_prev << ", y=" << y_prev_old << std::endl;
-    
-//         //  Élément suivant
-//         auto it_current = std::next(it_prev);
-//         if (it_current != breakpoints.end()) {
-//             double x_current = it_current->first;
-//             double y_current = y_prev_old + it_current->second;
-    
-//             bool prevUnder = y_prev_old < c;
-//             bool currAbove = y_current > c;
-    
-//             // std::cout << "Visiting first segment: x_current=" << x_current
-//             //           << ", y_current=" << y_current << std::endl;
-    
-//             // Traversée de c ?
-//             if (prevUnder && currAbove) {
-//                 // std::cout << "Crossing found in first segment" << std::endl;
-//                 double t = (c - y_prev_old) / (y_current - y_prev_old);
-//                 double xi = x_prev + t * (x_current - x_prev);
-    
-//                 // Ajouter breakpoint à xi avec delta 0
-//                 double deltaAtXi = 0;
-//                 breakpoints[xi] = deltaAtXi;
-//                 // std::cout << "Insert breakpoint at xi=" << xi << ", delta=" << deltaAtXi << std::endl;
-    
-//                 // Ajuster delta du point actuel
-//                 double remainingDelta = y_current - c;
-//                 it_current->second = remainingDelta;
-//                 // std::cout << "Adjust current delta: x=" << x_current
-//                 //           << ", remainingDelta=" << remainingDelta << std::endl;
-    
-//             } else {
-//                 if (c > y_prev_old) {
-//                     // Pas de coupure, ajuster delta
-//                     double newDelta = y_current - y_prev;
-//                     it_current->second = newDelta;
-//                     // std::cout << "No crossing zero under c, adjust delta: x=" << x_current
-//                     //           << ", newDelta=" << newDelta << std::endl;
-//                 } else {
-//                     double newDelta = y_current - y_prev_old;
-//                     it_current->second = newDelta;
-//                     // std::cout << "No crossing, adjust delta: x=" << x_current
-//                     //           << ", newDelta=" << newDelta << std::endl;
-//                 }
-//             }
-//         } else {
-//             // std::cout << "No element after first node" << std::endl;
-//         }
-    
-//         // Reconstruire points cumulés
-//         std::vector<std::pair<double, double>> points;
-//         double y = 0.0;
-//         for (auto &kv : breakpoints) {
-//             y += kv.second;
-//             points.push_back({kv.first, y});
-//             // std::cout << "Accumulated point: x=" << kv.first << ", y=" << y << std::endl;
-//         }
-    
-//         // Appliquer max avec c
-//         for (size_t i = 0; i < points.size() - 1; ++i) {
-//             double x = points[i + 1].first;
-//             double y_val = points[i + 1].second;
-    
-//             double y_prev = points[i].second;
-//             double x_prev = points[i].first;
-    
-//             bool prevUnder = y_prev < c;
-//             bool currUnder = y_val < c;
-    
-//             // std::cout << "\nVisiting segment: [" << x_prev << ", " << x << "] "
-//             //           << "y_prev=" << y_prev << ", y_curr=" << y_val << std::endl;
-    
-//             // Cas où on traverse la ligne y=c
-//             if ((prevUnder && y_val > c) || (y_prev > c && currUnder)) {
-//                 double t = (c - y_prev) / (y_val - y_prev);
-//                 double xi = x_prev + t * (x - x_prev);
-//                 double deltaAtXi = (y_prev <= c) ? 0 : c - y_prev;
-    
-//                 // std::cout << "Crossing found at x=" << xi << ", deltaAtXi=" << deltaAtXi << std::endl;
-//                 this->addBreakpoint(xi, deltaAtXi);
-    
-//                 if (prevUnder && y_val > c) {
-//                     double remainingDelta = y_val - c;
-//                     breakpoints[x] = remainingDelta;
-//                     points[i + 1].second = c + remainingDelta;
-//                     // std::cout << "Adjusting current delta: x=" << x << ", remainingDelta=" << remainingDelta << std::endl;
-//                 }
-//             }
-    
-//             // Cas où le point tombe exactement sur c
-//             if (prevUnder && y_val == c) {
-//                 // std::cout << "Breakpoint exactly at c at x =" << x << std::endl;
-//                 breakpoints[x] = 0;
-//                 points[i + 1].second = c;
-//             }
-    
-//             // Supprimer les nœuds en dessous de c
-//             if (y_val < c) {
-//                 // std::cout << "Deleting node under c: x=" << x << ", y=" << y_val << std::endl;
-//                 breakpoints.erase(x);
-//             }
-//         }
-    
-//         std::cout << "--- maxfunction end ---" << std::endl;
-//     }
-    
-//     PiecewiseLinearFunction& minfunc(double c) {
-//         this->minfunction(c);
-//         return *this;
-//     }
-    
-//     PiecewiseLinearFunction& maxfunc(double c) {
-//         this->maxfunction(c);
-//         return *this;
-//     }
+    void maxfunction(double c) {
+        clampConstant(c, false);
+    }
+
+    PiecewiseLinearFunction& minfunc(double c) {
+        this->minfunction(c);
+        return *this;
+    }
+
+    PiecewiseLinearFunction& maxfunc(double c) {
+        this->maxfunction(c);
+        return *this;
+    }
+
+//======================================================================================================
+//====================================== min(f, g) and max(f, g)  ======================================
+//======================================================================================================
+// Fusion des abscisses de f et de g (comme sum) : en chaque abscisse on garde min/max des deux
+// valeurs, et un point de croisement est inséré entre deux abscisses où f - g change de signe.
+    void minfunction(const PiecewiseLinearFunction& g) {
+        envelope(g, true);
+    }
+
+    void maxfunction(const PiecewiseLinearFunction& g) {
+        envelope(g, false);
+    }
+
+    PiecewiseLinearFunction& minfunc(const PiecewiseLinearFunction& g) {
+        this->minfunction(g);
+        return *this;
+    }
+
+    PiecewiseLinearFunction& maxfunc(const PiecewiseLinearFunction& g) {
+        this->maxfunction(g);
+        return *this;
+    }
+
+//======================================================================================================
+//====================================== compaction / simplification  ==================================
+//======================================================================================================
+// compact : retire, en une passe O(n), les breakpoints qui ne changent pas la fonction (deltaY nul
+// sur un palier, points alignés avec leurs voisins à COLLINEAR_ULPS epsilon près de leurs deltas) ;
+// le deltaY d'un point retiré passe au suivant. Ce report et la tolérance sur l'alignement donnent
+// un écart de l'ordre de l'arrondi (~3e-13 sur les profils du benchmark compact).
+// compactWindow fait de même sur les points de [lo, hi] (et leurs voisins immédiats) : c'est ce
+// que sum exécute sur sa fenêtre quand setAutoCompact(true). Les deux renvoient le nombre de
+// points retirés et passent par le trail et l'index.
+    size_t compact() {
+        materialize();
+        if (breakpoints.empty()) return 0;
+        return compactFrom(breakpoints.begin(), breakpoints.rbegin()->first);
+    }
+
+    size_t compactWindow(X lo, X hi) {
+        materialize();
+        if (breakpoints.empty()) return 0;
+        auto it = breakpoints.lower_bound(lo);
+        if (it != breakpoints.begin()) --it;
+        return compactFrom(it, hi);
+    }
+
+    void setAutoCompact(bool enabled) { auto_compact = enabled; }
+    bool isAutoCompact() const { return auto_compact; }
+    size_t compactedPoints() const { return compacted; }
+
+// simplify(tolerance) : garde un sous-ensemble des breakpoints tel que |f_nouvelle - f| <= tolerance
+// partout (aux arrondis près). Balayage glouton en O(n) : depuis le dernier point gardé A, on
+// maintient l'intervalle des pentes de A passant à moins de tolerance de chaque point sauté, et on
+// saute tant que la pente vers le point suivant y reste. Le premier et le dernier point sont gardés,
+// les deux fonctions sont linéaires entre points gardés : l'erreur maximale est atteinte en un
+// breakpoint, où elle est vérifiée. Renvoie le nombre de points retirés.
+    size_t simplify(double tolerance) {
+        materialize();
+        auto points = to_points_cumulative();
+        size_t n = points.size();
+        if (n <= 2 || !(tolerance >= 0.0)) return 0;
+
+        auto x_at = [&](size_t i) { return static_cast<double>(points[i].first); };
+        auto y_at = [&](size_t i) { return points[i].second; };
+
+        // erreur réelle (même interpolation que eval) des points sautés entre a et b
+        auto fits = [&](size_t a, size_t b) {
+            double slope = (y_at(b) - y_at(a)) / (x_at(b) - x_at(a));
+            for (size_t k = a + 1; k < b; ++k) {
+                if (std::abs(y_at(a) + slope * (x_at(k) - x_at(a)) - y_at(k)) > tolerance) return false;
+            }
+            return true;
+        };
+
+        std::vector<std::pair<X, double>> kept;
+        kept.push_back(points[0]);
+        size_t a = 0;
+        while (a + 1 < n) {
+            double lo = -INFINITY, hi = INFINITY;
+            size_t b = a + 1;
+            for (size_t j = a + 1; j < n; ++j) {
+                double dx = x_at(j) - x_at(a);
+                double slope = (y_at(j) - y_at(a)) / dx;
+                if (slope < lo || slope > hi) break;
+                b = j;
+                lo = std::max(lo, (y_at(j) - tolerance - y_at(a)) / dx);
+                hi = std::min(hi, (y_at(j) + tolerance - y_at(a)) / dx);
+                if (lo > hi) break;
+            }
+            while (b > a + 1 && !fits(a, b)) --b;   // arrondis : on recule si besoin
+            kept.push_back(points[b]);
+            a = b;
+        }
+
+        size_t removed = n - kept.size();
+        if (removed > 0) assignPoints(kept);
+        return removed;
+    }
+
+private:
+
+    // Un breakpoint est inutile si la fonction reste la même sans lui :
+    // - premier point : deltaY nul et le suivant aussi (f vaut 0 avant, et 0 jusqu'au suivant) ;
+    // - dernier point : deltaY nul (f est déjà constante après le précédent) ;
+    // - sinon : aligné avec ses voisins, d_i (x_n - x_i) == d_n (x_i - x_p).
+    // Retirer un point ne change pas l'alignement du précédent : une seule passe suffit.
+    static constexpr double COLLINEAR_ULPS = 4.0;
+
+    size_t compactFrom(typename Map::iterator it, X hi) {
+        size_t removed = 0;
+        bool has_prev = (it != breakpoints.begin());
+        X x_prev = has_prev ? std::prev(it)->first : X(0);
+
+        while (it != breakpoints.end()) {
+            auto next = std::next(it);
+            bool last_in_window = it->first > hi;
+            bool useless;
+            if (next == breakpoints.end()) {
+                useless = (it->second == 0.0);
+            } else if (!has_prev) {
+                useless = (it->second == 0.0 && next->second == 0.0);
+            } else {
+                // pentes égales aux arrondis près : un segment coupé par sum reçoit deux deltas
+                // arrondis chacun à quelques ulps de leur somme, jamais exactement proportionnels
+                double dx_next = static_cast<double>(next->first - it->first);
+                double dx_prev = static_cast<double>(it->first - x_prev);
+                double a = it->second * dx_next;
+                double b = next->second * dx_prev;
+                useless = std::abs(a - b) <= COLLINEAR_ULPS * std::numeric_limits<double>::epsilon() *
+                                                 (std::abs(it->second) + std::abs(next->second)) * (dx_prev + dx_next);
+            }
+
+            if (useless) {
+                if (next != breakpoints.end() && it->second != 0.0) writeDelta(next, next->second + it->second);
+                eraseDelta(it);
+                ++removed;
+            } else {
+                x_prev = it->first;
+                has_prev = true;
+            }
+            if (last_in_window) break;
+            it = next;
+        }
+        return removed;
+    }
+
+    // Remplace tous les breakpoints par les points absolus donnés (x croissants), en une passe ;
+    // l'index est reconstruit et le trail garde de quoi revenir à l'ancienne fonction
+    void assignPoints(const std::vector<std::pair<X, double>>& points) {
+        PWL_TRACE_TOUCH();
+        if (trailing) {
+            for (const auto& kv : breakpoints) trail.push_back({kv.first, kv.second, true});
+        }
+        // les noeuds de l'ancienne map sont recyclés (extract) au lieu d'être libérés puis réalloués
+        Map old;
+        old.swap(breakpoints);
+        double y_prev = 0.0;
+        for (const auto& p : points) {
+            if (!old.empty()) {
+                auto node = old.extract(old.begin());
+                node.key() = p.first;
+                node.mapped() = p.second - y_prev;
+                breakpoints.insert(breakpoints.end(), std::move(node));
+            } else {
+                breakpoints.emplace_hint(breakpoints.end(), p.first, p.second - y_prev);
+                PWL_COUNT(map_node_allocs, 1);
+            }
+            y_prev = p.second;
+            if (trailing) trail.push_back({p.first, 0.0, false});
+        }
+        PWL_COUNT(map_node_frees, old.size());
+        if (indexed) index.assign(breakpoints);
+    }
+
+    // Les croisements tombent entre deux abscisses : réservé aux abscisses flottantes
+    void clampConstant(double c, bool take_min) {
+        static_assert(!Coordinate<X>::exact, "min/max : les croisements ne sont pas des abscisses entières");
+        materialize();
+        if (breakpoints.empty()) return;
+
+        // au-delà de c : au-dessus pour min, en dessous pour max
+        auto beyond = [&](double v) { return take_min ? v > c : v < c; };
+
+        std::vector<std::pair<double, double>> points;
+        points.reserve(breakpoints.size() + 2);
+        double y = 0.0, x_prev = 0.0, y_prev = 0.0;
+        for (const auto& kv : breakpoints) {
+            double x = kv.first;
+            y += kv.second;
+            if (points.empty()) {
+                points.emplace_back(x, beyond(y) ? c : y);
+            } else {
+                // traversée stricte de y = c sur [x_prev, x]
+                if ((y_prev < c && y > c) || (y_prev > c && y < c)) {
+                    double xi = x_prev + (c - y_prev) * (x - x_prev) / (y - y_prev);
+                    if (xi > points.back().first && xi < x) points.emplace_back(xi, c);
+                }
+                if (!beyond(y)) points.emplace_back(x, y);
+            }
+            x_prev = x;
+            y_prev = y;
+        }
+        assignPoints(points);
+    }
+
+    void envelope(const PiecewiseLinearFunction& g, bool take_min) {
+        static_assert(!Coordinate<X>::exact, "min/max : les croisements ne sont pas des abscisses entières");
+        materialize();
+        auto fp = to_points_cumulative();
+        auto gp = g.to_points_cumulative();
+        if (gp.empty()) {   // g vide : fonction nulle
+            clampConstant(0.0, take_min);
+            return;
+        }
+
+        // valeur d'une fonction (points absolus p) en x, k = premier point d'abscisse >= x
+        auto value = [](const std::vector<std::pair<double, double>>& p, size_t k, double x) {
+            if (k < p.size() && p[k].first == x) return p[k].second;
+            if (k == 0) return 0.0;
+            if (k == p.size()) return p.back().second;
+            return p[k - 1].second + (p[k].second - p[k - 1].second) * (x - p[k - 1].first)
+                                     / (p[k].first - p[k - 1].first);
+        };
+
+        std::vector<std::pair<double, double>> points;
+        points.reserve(fp.size() + gp.size() + 8);
+        size_t i = 0, j = 0;
+        double x_prev = 0.0, a_prev = 0.0, b_prev = 0.0;
+        while (i < fp.size() || j < gp.size()) {
+            double x;
+            if (j == gp.size() || (i < fp.size() && fp[i].first < gp[j].first)) x = fp[i].first;
+            else x = gp[j].first;
+
+            double a = value(fp, i, x);
+            double b = value(gp, j, x);
+
+            if (!points.empty()) {
+                double d_prev = a_prev - b_prev, d = a - b;
+                if ((d_prev < 0 && d > 0) || (d_prev > 0 && d < 0)) {
+                    double t = d_prev / (d_prev - d);
+                    double xi = x_prev + t * (x - x_prev);
+                    if (xi > x_prev && xi < x) points.emplace_back(xi, a_prev + t * (a - a_prev));
+                }
+            }
+            points.emplace_back(x, take_min ? std::min(a, b) : std::max(a, b));
+
+            if (i < fp.size() && fp[i].first == x) ++i;
+            if (j < gp.size() && gp[j].first == x) ++j;
+            x_prev = x;
+            a_prev = a;
+            b_prev = b;
+        }
+        assignPoints(points);
+    }
+
+public:
     
 
 
@@ -428,36 +1247,33 @@ public:
 //======================================  utile pour print/draw python        =====================================
 //=================================================================================================================
     // Exportation des points vers un fichier
+    // Une ligne "x f(x)" par breakpoint, écrite par text::Writer (relue par importFunction)
     void exportFunction(const std::string& filename) const {
-        std::ofstream out(filename);
-        if (!out) {
+        PWL_TRACE_CALL();
+        PWL_TRACE(exportFunction, *this);
+        text::Writer out(filename);
+        if (!out.ok()) {
             std::cerr << "Erreur: impossible d'ouvrir le fichier " << filename << std::endl;
             return;
         }
 
-        std::vector<std::pair<double, double>> points;
         double currentY = 0.0;
-        for (const auto& pair : breakpoints) {
+        for (const auto& pair : *this) {
             currentY += pair.second;
-            points.push_back({pair.first, currentY});
-        }
-        
-        for (const auto& pair : points) {
-            out << pair.first << " " << pair.second << "\n";
+            out.point(static_cast<double>(pair.first), currentY, ' ');
         }
 
         out.close();
-        std::cout << "Fonction exportee vers " << filename << std::endl;
     }
 
 //======================================================================================================
 //======================================  Extract points (x,f(x))   =====================================
 //=======================================================================================================
-    std::vector<std::pair<double, double>> to_points_cumulative() const {
-        std::vector<std::pair<double, double>> points;
+    std::vector<std::pair<X, double>> to_points_cumulative() const {
+        std::vector<std::pair<X, double>> points;
         double y = 0.0;
     
-        for (const auto& kv : breakpoints) {
+        for (const auto& kv : *this) {
             y += kv.second;                // cumul des deltas
             points.emplace_back(kv.first, y); // (x, valeur réelle de f(x))
         }
@@ -471,24 +1287,121 @@ public:
 //=================================================================================================================
 
 // Fonctions utilitaires pour construire des profils particuliers
-inline PiecewiseLinearFunction delta_profile(double gap, double a, double b, double c) {
-    PiecewiseLinearFunction delta;
+template<typename X>
+BasicPiecewiseLinearFunction<X> delta_profile(double gap, typename identity<X>::type a,
+                                              typename identity<X>::type b, typename identity<X>::type c) {
+    BasicPiecewiseLinearFunction<X> delta;
     delta.addBreakpoint(a, 0);
     delta.addBreakpoint(b, gap);
     delta.addBreakpoint(c, -gap);
-    if(a>0.0){delta.removeBreakpoint(0.0);}
+    if(a>X(0)){delta.removeBreakpoint(X(0));}
     return delta;
 }
 
-inline PiecewiseLinearFunction cba_profile(double cap, double a, double b) {
+template<typename X>
+BasicPiecewiseLinearFunction<X> cba_profile(double cap, typename identity<X>::type a,
+                                            typename identity<X>::type b) {
 
-    PiecewiseLinearFunction cba;
+    BasicPiecewiseLinearFunction<X> cba;
     cba.addBreakpoint(a, 0);
     cba.addBreakpoint(b, cap);
-    if(a>0.0){cba.removeBreakpoint(0.0);}
+    if(a>X(0)){cba.removeBreakpoint(X(0));}
     return cba;
 }
 
+//=================================================================================================================
+//======================================  Somme de N profils en une passe     =====================================
+//=================================================================================================================
+// Chaque profil est décomposé en événements : un saut de valeur à son premier point, puis
+// +pente/-pente au début/à la fin de chaque segment. Après un tri global (O(N log N)), un seul
+// balayage cumule les pentes et écrit les deltaY du résultat, en ordre croissant de x.
+// Comme sum(), un premier point de deltaY non nul est relié par un segment au point précédent.
+template<typename X>
+BasicPiecewiseLinearFunction<X> sum_all(const BasicPiecewiseLinearFunction<X>* profiles, size_t count) {
+    struct Event {
+        X x;
+        double jump, dslope;
+        int dopen;   // segments ouverts (+1) ou fermés (-1)
+    };
+
+    size_t total = 0;
+    for (size_t k = 0; k < count; ++k) total += 2 * profiles[k].breakpoints.size();
+
+    std::vector<Event> events;
+    events.reserve(total);
+    for (size_t k = 0; k < count; ++k) {
+        const BasicPiecewiseLinearFunction<X>& p = profiles[k];
+        if (p.breakpoints.empty()) continue;
+        auto it = p.begin();   // tag éventuel appliqué
+        X x_prev = it->first;
+        events.push_back({x_prev, it->second, 0.0, 0});
+        for (++it; it != p.end(); ++it) {
+            double slope = it->second / static_cast<double>(it->first - x_prev);
+            events.push_back({x_prev, 0.0, slope, 1});
+            events.push_back({it->first, 0.0, -slope, -1});
+            x_prev = it->first;
+        }
+    }
+
+    std::sort(events.begin(), events.end(),
+              [](const Event& a, const Event& b) { return a.x < b.x; });
+
+    BasicPiecewiseLinearFunction<X> result;
+    result.breakpoints.clear();
+
+    double slope = 0.0;
+    X x_prev = X(0);
+    int open = 0;
+    size_t i = 0;
+    while (i < events.size()) {
+        X x = events[i].x;
+        double delta = (i == 0) ? 0.0 : slope * static_cast<double>(x - x_prev);
+        double dslope = 0.0;
+        while (i < events.size() && events[i].x == x) {
+            delta += events[i].jump;
+            dslope += events[i].dslope;
+            open += events[i].dopen;
+            ++i;
+        }
+        result.breakpoints.emplace_hint(result.breakpoints.end(), x, delta);
+
+        // plus aucun segment ouvert : la pente est exactement nulle (pas de dérive d'arrondi)
+        slope = (open == 0) ? 0.0 : slope + dslope;
+        x_prev = x;
+    }
+
+    return result;
+}
+
+template<typename X>
+BasicPiecewiseLinearFunction<X> sum_all(const std::vector<BasicPiecewiseLinearFunction<X>>& profiles) {
+    return sum_all(profiles.data(), profiles.size());
+}
+
+//=================================================================================================================
+//======================================  Lecture d'un export texte           =====================================
+//=================================================================================================================
+// Points absolus (x, f(x)) à x strictement croissant, ajoutés en fin : O(n) au total
+inline PiecewiseLinearFunction importFunction(const std::string& filename) {
+    text::Reader in(filename);
+    PiecewiseLinearFunction f;
+    f.clear();
+
+    double x, y, x_prev = 0.0, y_prev = 0.0;
+    bool first = true;
+    while (in.next(x, y)) {
+        if (!first && !(x > x_prev)) {
+            throw std::runtime_error(filename + " ligne " + std::to_string(in.lineNumber()) +
+                                     " : abscisses non croissantes");
+        }
+        f.appendBreakpoint(x, y - y_prev);
+        x_prev = x;
+        y_prev = y;
+        first = false;
+    }
+    return f;
+}
+
 
 
 
@@ -0,0 +1,439 @@
+#ifndef PIECEWISE_MULTI_HPP
+#define PIECEWISE_MULTI_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <vector>
+#include "piecewise_map.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace multi_version {
+
+// K ressources (CPU, mémoire, licences...) sur la même échelle de temps : un seul arbre de
+// breakpoints, chaque point portant les K deltaY côte à côte (Values<K>, 32 octets d'alignement).
+// Mêmes conventions que map_version : 0 avant le premier point, interpolation linéaire, constant
+// après le dernier. Ajouter une tâche multi-ressources coûte une fusion au lieu de K, et les
+// opérations sur les valeurs (cumul, interpolation, max/min) traitent les K voies ensemble,
+// 4 par instruction avec AVX2 (repli scalaire sinon, ou si K n'est pas multiple de 4).
+//
+// Les calculs de chaque voie sont ceux de map_version dans le même ordre (sans FMA) : chaque
+// ressource est identique bit à bit à la fonction map_version correspondante.
+//
+// Une ressource peut commencer après le premier point de l'arbre (from() sur des fonctions qui ne
+// démarrent pas au même x) : son origine est gardée par voie, et la voie vaut 0 avant, comme
+// map_version avant son premier point. Par défaut l'origine est le premier point de l'arbre.
+// L'identité bit à bit avec map_version vaut pour sum quand toutes les voies partagent l'origine ;
+// sinon la marche d'une voie à son origine devient, après sum, une rampe depuis le point
+// précédent de l'arbre (map_version la prolonge depuis le point précédent de f et g).
+
+template<size_t K>
+struct alignas(32) Values {
+    double v[K];
+
+    static Values broadcast(double y) {
+        Values r;
+        for (size_t k = 0; k < K; ++k) r.v[k] = y;
+        return r;
+    }
+
+    double& operator[](size_t k) { return v[k]; }
+    double operator[](size_t k) const { return v[k]; }
+};
+
+// Opérations voie par voie
+namespace lanes {
+
+#if defined(__AVX2__)
+template<size_t K>
+constexpr bool VECTOR = K % 4 == 0;
+#else
+template<size_t K>
+constexpr bool VECTOR = false;
+#endif
+
+template<size_t K>
+inline Values<K> add(const Values<K>& a, const Values<K>& b) {
+    Values<K> r;
+#if defined(__AVX2__)
+    if constexpr (VECTOR<K>) {
+        for (size_t k = 0; k < K; k += 4) {
+            _mm256_storeu_pd(r.v + k, _mm256_add_pd(_mm256_loadu_pd(a.v + k), _mm256_loadu_pd(b.v + k)));
+        }
+        return r;
+    }
+#endif
+    for (size_t k = 0; k < K; ++k) r.v[k] = a.v[k] + b.v[k];
+    return r;
+}
+
+template<size_t K>
+inline Values<K> sub(const Values<K>& a, const Values<K>& b) {
+    Values<K> r;
+#if defined(__AVX2__)
+    if constexpr (VECTOR<K>) {
+        for (size_t k = 0; k < K; k += 4) {
+            _mm256_storeu_pd(r.v + k, _mm256_sub_pd(_mm256_loadu_pd(a.v + k), _mm256_loadu_pd(b.v + k)));
+        }
+        return r;
+    }
+#endif
+    for (size_t k = 0; k < K; ++k) r.v[k] = a.v[k] - b.v[k];
+    return r;
+}
+
+// y + d * num / den (ordre de map_version::sum)
+template<size_t K>
+inline Values<K> ramp(const Values<K>& y, const Values<K>& d, double num, double den) {
+    Values<K> r;
+#if defined(__AVX2__)
+    if constexpr (VECTOR<K>) {
+        const __m256d vnum = _mm256_set1_pd(num), vden = _mm256_set1_pd(den);
+        for (size_t k = 0; k < K; k += 4) {
+            __m256d t = _mm256_div_pd(_mm256_mul_pd(_mm256_loadu_pd(d.v + k), vnum), vden);
+            _mm256_storeu_pd(r.v + k, _mm256_add_pd(_mm256_loadu_pd(y.v + k), t));
+        }
+        return r;
+    }
+#endif
+    for (size_t k = 0; k < K; ++k) r.v[k] = y.v[k] + d.v[k] * num / den;
+    return r;
+}
+
+// y0 + (y1 - y0) / den * num (ordre de map_version::eval)
+template<size_t K>
+inline Values<K> interpolate(const Values<K>& y0, const Values<K>& y1, double num, double den) {
+    Values<K> r;
+#if defined(__AVX2__)
+    if constexpr (VECTOR<K>) {
+        const __m256d vnum = _mm256_set1_pd(num), vden = _mm256_set1_pd(den);
+        for (size_t k = 0; k < K; k += 4) {
+            __m256d a = _mm256_loadu_pd(y0.v + k);
+            __m256d slope = _mm256_div_pd(_mm256_sub_pd(_mm256_loadu_pd(y1.v + k), a), vden);
+            _mm256_storeu_pd(r.v + k, _mm256_add_pd(a, _mm256_mul_pd(slope, vnum)));
+        }
+        return r;
+    }
+#endif
+    for (size_t k = 0; k < K; ++k) {
+        double slope = (y1.v[k] - y0.v[k]) / den;
+        r.v[k] = y0.v[k] + slope * num;
+    }
+    return r;
+}
+
+template<size_t K>
+inline Values<K> max(const Values<K>& a, const Values<K>& b) {
+    Values<K> r;
+#if defined(__AVX2__)
+    if constexpr (VECTOR<K>) {
+        for (size_t k = 0; k < K; k += 4) {
+            _mm256_storeu_pd(r.v + k, _mm256_max_pd(_mm256_loadu_pd(a.v + k), _mm256_loadu_pd(b.v + k)));
+        }
+        return r;
+    }
+#endif
+    for (size_t k = 0; k < K; ++k) r.v[k] = a.v[k] > b.v[k] ? a.v[k] : b.v[k];
+    return r;
+}
+
+template<size_t K>
+inline Values<K> min(const Values<K>& a, const Values<K>& b) {
+    Values<K> r;
+#if defined(__AVX2__)
+    if constexpr (VECTOR<K>) {
+        for (size_t k = 0; k < K; k += 4) {
+            _mm256_storeu_pd(r.v + k, _mm256_min_pd(_mm256_loadu_pd(a.v + k), _mm256_loadu_pd(b.v + k)));
+        }
+        return r;
+    }
+#endif
+    for (size_t k = 0; k < K; ++k) r.v[k] = a.v[k] < b.v[k] ? a.v[k] : b.v[k];
+    return r;
+}
+
+// y[k], ou 0 pour les voies où x < origin[k]
+template<size_t K>
+inline Values<K> zero_before(const Values<K>& y, const Values<K>& origin, double x) {
+    Values<K> r;
+#if defined(__AVX2__)
+    if constexpr (VECTOR<K>) {
+        const __m256d vx = _mm256_set1_pd(x);
+        for (size_t k = 0; k < K; k += 4) {
+            __m256d before = _mm256_cmp_pd(vx, _mm256_loadu_pd(origin.v + k), _CMP_LT_OQ);
+            _mm256_storeu_pd(r.v + k, _mm256_andnot_pd(before, _mm256_loadu_pd(y.v + k)));
+        }
+        return r;
+    }
+#endif
+    for (size_t k = 0; k < K; ++k) r.v[k] = x < origin.v[k] ? 0.0 : y.v[k];
+    return r;
+}
+
+// a[k] <= b[k] pour toutes les voies
+template<size_t K>
+inline bool all_le(const Values<K>& a, const Values<K>& b) {
+#if defined(__AVX2__)
+    if constexpr (VECTOR<K>) {
+        int over = 0;
+        for (size_t k = 0; k < K; k += 4) {
+            over |= _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(a.v + k), _mm256_loadu_pd(b.v + k), _CMP_GT_OQ));
+        }
+        return over == 0;
+    }
+#endif
+    for (size_t k = 0; k < K; ++k) {
+        if (a.v[k] > b.v[k]) return false;
+    }
+    return true;
+}
+
+}
+
+template<size_t K>
+class PiecewiseLinearFunction {
+public:
+    using Value = Values<K>;
+    using Map = std::map<double, Value>;
+
+    // map où la clé est l'abscisse (x) et la valeur les K deltaY
+    PiecewiseLinearFunction(double y0 = 0.0) { breakpoints[0.0] = Value::broadcast(y0); }
+
+    explicit PiecewiseLinearFunction(const Value& y0) { breakpoints[0.0] = y0; }
+
+    // Regroupe K fonctions map_version (une par ressource) sur l'union de leurs abscisses.
+    // Chaque voie reprend les deltaY de sa ressource à ses propres abscisses ; aux autres, le
+    // delta interpolé sur son segment, 0 avant son premier point et après son dernier.
+    static PiecewiseLinearFunction from(const map_version::PiecewiseLinearFunction* resources) {
+        std::vector<double> xs;
+        for (size_t k = 0; k < K; ++k) {
+            for (const auto& kv : resources[k]) xs.push_back(kv.first);
+        }
+        std::sort(xs.begin(), xs.end());
+        xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+
+        std::vector<Value> deltas(xs.size(), Value::broadcast(0.0));
+        Value origin;
+        for (size_t k = 0; k < K; ++k) {
+            const auto& r = resources[k];
+            origin.v[k] = r.size() ? r.begin()->first : std::numeric_limits<double>::infinity();
+            auto it = r.begin();
+            double x_prev = 0.0, y_prev = 0.0;   // dernier point de la ressource
+            double lane = 0.0;                   // valeur de la voie au dernier x de l'union
+            bool own_prev = false;               // le dernier x de l'union est un point de la ressource
+            for (size_t i = 0; i < xs.size() && it != r.end(); ++i) {
+                if (xs[i] < it->first && it == r.begin()) continue;   // avant le premier point : 0
+                double d;
+                if (xs[i] == it->first) {
+                    double y = y_prev + it->second;
+                    d = own_prev ? it->second : y - lane;
+                    x_prev = it->first;
+                    y_prev = y;
+                    lane = y;
+                    own_prev = true;
+                    ++it;
+                } else {
+                    double y_curr = y_prev + it->second;
+                    double slope = (y_curr - y_prev) / (it->first - x_prev);
+                    double y = y_prev + slope * (xs[i] - x_prev);
+                    d = y - lane;
+                    lane = y;
+                    own_prev = false;
+                }
+                deltas[i].v[k] = d;
+            }
+        }
+
+        PiecewiseLinearFunction f;
+        f.clear();
+        for (size_t i = 0; i < xs.size(); ++i) f.appendBreakpoint(xs[i], deltas[i]);
+        f.origin = origin;
+        return f;
+    }
+
+    // Ressource k seule, en map_version (à partir de son origine)
+    map_version::PiecewiseLinearFunction resource(size_t k) const {
+        map_version::PiecewiseLinearFunction f;
+        f.clear();
+        for (auto it = breakpoints.lower_bound(origin.v[k]); it != breakpoints.end(); ++it) {
+            f.appendBreakpoint(it->first, it->second.v[k]);
+        }
+        return f;
+    }
+
+    // Première abscisse de chaque ressource (-inf : premier point de l'arbre)
+    const Value& origins() const { return origin; }
+
+    void addBreakpoint(double x, const Value& deltaY) { breakpoints[x] = deltaY; }
+
+    // Ajout en fin (x strictement supérieur au dernier breakpoint) : O(1) amorti
+    void appendBreakpoint(double x, const Value& deltaY) {
+        breakpoints.emplace_hint(breakpoints.end(), x, deltaY);
+    }
+
+    void removeBreakpoint(double x) { breakpoints.erase(x); }
+
+    void clear() {
+        breakpoints.clear();
+        origin = Value::broadcast(-std::numeric_limits<double>::infinity());
+    }
+
+    size_t size() const { return breakpoints.size(); }
+
+    typename Map::const_iterator begin() const { return breakpoints.begin(); }
+    typename Map::const_iterator end() const { return breakpoints.end(); }
+
+    // Les K valeurs en x (parcours de map_version::eval, voies ensemble)
+    Value evaluate(double x) const {
+        Value zero = Value::broadcast(0.0);
+        if (breakpoints.empty() || x < breakpoints.begin()->first) return zero;
+
+        auto it = breakpoints.begin();
+        double x_prev = it->first;
+        Value y_prev = it->second;
+        for (++it; it != breakpoints.end(); ++it) {
+            Value y_curr = lanes::add(y_prev, it->second);
+            if (x <= it->first + map_version::EPSILON) {
+                return lanes::zero_before(lanes::interpolate(y_prev, y_curr, x - x_prev, it->first - x_prev), origin, x);
+            }
+            x_prev = it->first;
+            y_prev = y_curr;
+        }
+        return lanes::zero_before(y_prev, origin, x);
+    }
+
+    // max (ou min) de chaque ressource sur [lo, hi] : bornes et breakpoints intérieurs
+    Value peak(double lo, double hi) const { return extremum(lo, hi, true); }
+    Value trough(double lo, double hi) const { return extremum(lo, hi, false); }
+
+    // Toutes les ressources restent sous cap sur [lo, hi]
+    bool fits(const Value& cap, double lo, double hi) const { return lanes::all_le(peak(lo, hi), cap); }
+
+//======================================================================================================
+//==========================              sum f+g (K voies)           ==================================
+//======================================================================================================
+// Balayage de map_version::sumPoints : une seule fusion des abscisses pour les K ressources,
+// valeurs relatives au dernier point de f avant la fenêtre de g.
+    void sum(const PiecewiseLinearFunction& g) {
+        if (g.breakpoints.empty()) return;
+        PWL_COUNT(sum_calls, 1);
+        const Value zero = Value::broadcast(0.0);
+
+        double xg_min = g.breakpoints.begin()->first;
+        double xg_max = std::prev(g.breakpoints.end())->first;
+        auto it_f = breakpoints.lower_bound(xg_min);
+        auto end_f = breakpoints.upper_bound(xg_max);
+        PWL_COUNT(map_lookups, 2);
+        auto it_g = g.breakpoints.begin();
+        auto g_end = g.breakpoints.end();
+
+        // voies de f qui commencent après le premier point de l'arbre : F = 0 avant leur origine
+        // (map_version : pas de point de f avant la fenêtre)
+        double late = -std::numeric_limits<double>::infinity();
+        for (size_t k = 0; k < K; ++k) late = std::max(late, origin.v[k]);
+
+        bool has_prev_f = (it_f != breakpoints.begin());
+        double xf_prev = has_prev_f ? std::prev(it_f)->first : 0.0;
+        Value yf_prev = zero;
+        double xg_prev = xg_min;
+        Value yg_prev = zero;
+        Value yi_prec = zero;
+
+        while (it_f != end_f || it_g != g_end) {
+            double x;
+            bool take_f = false, take_g = false;
+            PWL_COUNT(sum_merge_steps, 1);
+            if (it_g != g_end && (it_f == end_f || it_g->first < it_f->first)) {
+                x = it_g->first;
+                take_g = true;
+            } else if (it_f != end_f && (it_g == g_end || it_f->first < it_g->first)) {
+                x = it_f->first;
+                take_f = true;
+            } else {
+                x = it_f->first;
+                take_f = take_g = true;
+            }
+
+            Value F;
+            if (take_f) {
+                F = lanes::add(yf_prev, it_f->second);
+            } else if (!has_prev_f || it_f == breakpoints.end()) {
+                F = yf_prev;
+            } else {
+                F = lanes::ramp(yf_prev, it_f->second, x - xf_prev, it_f->first - xf_prev);
+            }
+            if (x < late) F = lanes::zero_before(F, origin, x);
+
+            Value G = take_g ? lanes::add(yg_prev, it_g->second)
+                             : lanes::ramp(yg_prev, it_g->second, x - xg_prev, it_g->first - xg_prev);
+
+            Value total = lanes::add(F, G);
+            Value delta = lanes::sub(total, yi_prec);
+            yi_prec = total;
+
+            if (take_f) {
+                it_f->second = delta;
+                xf_prev = x;
+                yf_prev = F;
+                has_prev_f = true;
+                ++it_f;
+            } else {
+                breakpoints.emplace_hint(it_f, x, delta);
+                PWL_COUNT(map_node_allocs, 1);
+            }
+            if (take_g) {
+                xg_prev = x;
+                yg_prev = G;
+                ++it_g;
+            }
+        }
+
+        if (it_f != breakpoints.end()) {
+            Value F = lanes::add(yf_prev, it_f->second);
+            it_f->second = lanes::sub(lanes::add(F, yg_prev), yi_prec);
+        }
+
+        // comme map_version, le résultat commence au premier point de f ou de g
+        for (size_t k = 0; k < K; ++k) {
+            origin.v[k] = std::min(origin.v[k], std::max(xg_min, g.origin.v[k]));
+        }
+    }
+
+private:
+    Map breakpoints;
+    Value origin = Value::broadcast(-std::numeric_limits<double>::infinity());
+
+    Value extremum(double lo, double hi, bool take_max) const {
+        auto pick = [&](const Value& a, const Value& b) { return take_max ? lanes::max(a, b) : lanes::min(a, b); };
+        Value best = pick(evaluate(lo), evaluate(hi));
+        Value y = Value::broadcast(0.0);
+        for (const auto& kv : breakpoints) {
+            if (kv.first > hi) break;
+            y = lanes::add(y, kv.second);
+            if (kv.first >= lo) best = pick(best, y);
+        }
+        return best;
+    }
+};
+
+// Tâche sur K ressources : 0 en a, gap[k] en b, retour à 0 en c (comme map_version::delta_profile)
+template<size_t K>
+PiecewiseLinearFunction<K> delta_profile(const Values<K>& gap, double a, double b, double c) {
+    PiecewiseLinearFunction<K> delta;
+    delta.clear();
+    Values<K> minus;
+    for (size_t k = 0; k < K; ++k) minus.v[k] = -gap.v[k];
+    delta.appendBreakpoint(a, Values<K>::broadcast(0.0));
+    delta.appendBreakpoint(b, gap);
+    delta.appendBreakpoint(c, minus);
+    return delta;
+}
+
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef PIECEWISE_PARALLEL_HPP
+#define PIECEWISE_PARALLEL_HPP
+
+#include <vector>
+#include <algorithm>
+#include "piecewise.hpp"
+#include "piecewise_map.hpp"
+#include "thread_pool.hpp"
+
+// Réductions parallèles de grands ensembles de profils.
+//
+// Les profils sont découpés en blocs de `grain` profils (le découpage ne dépend que du nombre
+// de profils, jamais du nombre de threads). Chaque bloc est sommé en une passe (sum_all/add_all),
+// puis les sommes partielles sont fusionnées deux à deux en arbre : 0+1, 2+3, ... puis 0+2, ...
+// L'ordre des opérations flottantes est donc fixe et le résultat est identique bit à bit quel
+// que soit le nombre de threads du pool ; seul `grain` change l'arrondi.
+
+namespace parallel {
+
+const size_t DEFAULT_GRAIN = 4096;
+
+// Fusion en arbre des sommes partielles, niveau par niveau ; merge(a, b) ajoute b dans a
+template<typename Function, typename Merge>
+void tree_reduce(std::vector<Function>& partials, ThreadPool& pool, Merge merge) {
+    for (size_t stride = 1; stride < partials.size(); stride *= 2) {
+        size_t pairs = (partials.size() + 2 * stride - 1) / (2 * stride);
+        pool.parallel_for(pairs, [&](size_t p) {
+            size_t i = 2 * stride * p;
+            if (i + stride < partials.size()) {
+                merge(partials[i], partials[i + stride]);
+                partials[i + stride] = Function();
+            }
+        });
+    }
+}
+
+inline map_version::PiecewiseLinearFunction sum_all(
+        const std::vector<map_version::PiecewiseLinearFunction>& profiles,
+        ThreadPool& pool, size_t grain = DEFAULT_GRAIN) {
+    if (profiles.empty()) return map_version::sum_all(profiles);
+
+    grain = std::max<size_t>(1, grain);
+    size_t blocks = (profiles.size() + grain - 1) / grain;
+    std::vector<map_version::PiecewiseLinearFunction> partials(blocks);
+
+    pool.parallel_for(blocks, [&](size_t b) {
+        size_t first = b * grain;
+        size_t count = std::min(grain, profiles.size() - first);
+        partials[b] = map_version::sum_all(profiles.data() + first, count);
+    });
+
+    tree_reduce(partials, pool, [](map_version::PiecewiseLinearFunction& a,
+                                   const map_version::PiecewiseLinearFunction& b) {
+        a.sum(b);
+    });
+    return std::move(partials[0]);
+}
+
+inline list_version::PiecewiseLinearFunction add_all(
+        const std::vector<list_version::PiecewiseLinearFunction>& functions,
+        ThreadPool& pool, size_t grain = DEFAULT_GRAIN) {
+    if (functions.empty()) return list_version::add_all(functions);
+
+    grain = std::max<size_t>(1, grain);
+    size_t blocks = (functions.size() + grain - 1) / grain;
+    std::vector<list_version::PiecewiseLinearFunction> partials(blocks);
+
+    pool.parallel_for(blocks, [&](size_t b) {
+        size_t first = b * grain;
+        size_t count = std::min(grain, functions.size() - first);
+        partials[b] = list_version::add_all(functions.data() + first, count);
+    });
+
+    tree_reduce(partials, pool, [](list_version::PiecewiseLinearFunction& a,
+                                   const list_version::PiecewiseLinearFunction& b) {
+        a.add(b);
+    });
+    return std::move(partials[0]);
+}
+
+// Somme exclusive en place (balayage de Blelloch, un parallel_for par niveau) ; renvoie le total
+inline size_t exclusive_scan(std::vector<size_t>& v, ThreadPool& pool) {
+    size_t count = v.size(), n = 1;
+    while (n < count) n *= 2;
+    v.resize(n, 0);
+    for (size_t stride = 1; stride < n; stride *= 2) {   // montée : v[k] = total de son bloc
+        pool.parallel_for(n / (2 * stride), [&](size_t p) {
+            size_t k = 2 * stride * (p + 1) - 1;
+            v[k] += v[k - stride];
+        });
+    }
+    size_t total = v[n - 1];
+    v[n - 1] = 0;
+    for (size_t stride = n / 2; stride >= 1; stride /= 2) {   // descente : préfixes exclusifs
+        pool.parallel_for(n / (2 * stride), [&](size_t p) {
+            size_t k = 2 * stride * (p + 1) - 1;
+            size_t left = v[k - stride];
+            v[k - stride] = v[k];
+            v[k] += left;
+        });
+    }
+    v.resize(count);
+    return total;
+}
+
+// Somme de deux grands profils par balayage segmenté : f + g dans un nouveau profil.
+//
+// Les breakpoints de f et g sont recopiés dans des tableaux, puis l'ordre fusionné est découpé en
+// blocs de `grain` points aux quantiles de rang (recherche dichotomique dans les deux tableaux ;
+// une abscisse commune reste dans un seul bloc). Le découpage ne dépend pas du nombre de threads.
+//  1. chaque bloc compte ses abscisses distinctes ;
+//  2. une somme préfixe parallèle donne la position de sortie de chaque bloc ;
+//  3. chaque bloc écrit ses deltaY à sa position.
+// Un deltaY de f+g ne dépend que du point fusionné précédent : (f+g)(x) - (f+g)(x_prev) est la
+// somme des variations de f et de g sur [x_prev, x], lues sur le segment qui contient x (la
+// variation entière du segment quand x_prev et x en sont les extrémités). Le premier bloc
+// relit x_prev dans les tableaux : aucune valeur cumulée ne traverse les frontières de blocs,
+// et les deltaY hors de la fenêtre de g sont recopiés tels quels.
+// Mêmes breakpoints que f.sum(g), valeurs égales aux arrondis près ; résultat identique bit à
+// bit quel que soit le nombre de threads. La construction finale de la map reste séquentielle.
+template<typename X>
+map_version::BasicPiecewiseLinearFunction<X> sum(const map_version::BasicPiecewiseLinearFunction<X>& f,
+                                                 const map_version::BasicPiecewiseLinearFunction<X>& g,
+                                                 ThreadPool& pool, size_t grain = DEFAULT_GRAIN) {
+    std::vector<X> fx, gx;
+    std::vector<double> fd, gd;
+    fx.reserve(f.size());
+    fd.reserve(f.size());
+    gx.reserve(g.size());
+    gd.reserve(g.size());
+    for (const auto& p : f) {
+        fx.push_back(p.first);
+        fd.push_back(p.second);
+    }
+    for (const auto& p : g) {
+        gx.push_back(p.first);
+        gd.push_back(p.second);
+    }
+    const size_t n = fx.size(), m = gx.size();
+
+    // bornes des blocs : i points de f et j points de g avant la frontière
+    grain = std::max<size_t>(2, grain);
+    size_t blocks = std::max<size_t>(1, (n + m + grain - 1) / grain);
+    std::vector<size_t> bi(blocks + 1), bj(blocks + 1);
+    bi[blocks] = n;
+    bj[blocks] = m;
+    pool.parallel_for(blocks, [&](size_t k) {
+        // rang r de l'ordre fusionné (à égalité, le point de f passe en premier)
+        size_t r = k * grain;
+        size_t lo = r > m ? r - m : 0, hi = std::min(r, n);
+        while (lo < hi) {
+            size_t i = (lo + hi) / 2, j = r - i;
+            if (j == 0 || i == n || gx[j - 1] < fx[i]) hi = i;
+            else lo = i + 1;
+        }
+        size_t i = lo, j = r - lo;
+        if (i > 0 && j < m && fx[i - 1] == gx[j]) ++j;   // abscisse commune : dans le bloc précédent
+        bi[k] = i;
+        bj[k] = j;
+    });
+
+    // Parcours fusionné du bloc k ; emit(x, deltaY) si Write
+    auto walk = [&](size_t k, auto emit) {
+        size_t i = bi[k], j = bj[k];
+        const size_t i_end = bi[k + 1], j_end = bj[k + 1];
+        X x_prev = X(0);
+        if (i > 0) x_prev = fx[i - 1];
+        if (j > 0 && (i == 0 || gx[j - 1] > x_prev)) x_prev = gx[j - 1];
+
+        // variation sur [x_prev, x] du profil (xs, ds), dont le prochain point est l'indice idx
+        auto piece = [&](const std::vector<X>& xs, const std::vector<double>& ds, size_t idx, X x, bool take) {
+            if (idx == xs.size()) return 0.0;             // constant après le dernier point
+            if (idx == 0) return take ? ds[0] : 0.0;      // 0 avant le premier point
+            return ds[idx] * static_cast<double>(x - x_prev) / static_cast<double>(xs[idx] - xs[idx - 1]);
+        };
+
+        while (i < i_end || j < j_end) {
+            X x;
+            bool take_f = false, take_g = false;
+            if (j < j_end && (i == i_end || gx[j] < fx[i])) {
+                x = gx[j];
+                take_g = true;
+            } else if (i < i_end && (j == j_end || fx[i] < gx[j])) {
+                x = fx[i];
+                take_f = true;
+            } else {
+                x = fx[i];
+                take_f = take_g = true;
+            }
+            emit(x, [&] { return piece(fx, fd, i, x, take_f) + piece(gx, gd, j, x, take_g); });
+            x_prev = x;
+            if (take_f) ++i;
+            if (take_g) ++j;
+        }
+    };
+
+    std::vector<size_t> offsets(blocks);
+    pool.parallel_for(blocks, [&](size_t k) {
+        size_t count = 0;
+        walk(k, [&](X, auto) { ++count; });
+        offsets[k] = count;
+    });
+    size_t total = exclusive_scan(offsets, pool);
+
+    std::vector<X> rx(total);
+    std::vector<double> rd(total);
+    pool.parallel_for(blocks, [&](size_t k) {
+        size_t out = offsets[k];
+        walk(k, [&](X x, auto delta) {
+            rx[out] = x;
+            rd[out] = delta();
+            ++out;
+        });
+    });
+
+    map_version::BasicPiecewiseLinearFunction<X> result;
+    result.clear();
+    for (size_t k = 0; k < total; ++k) result.appendBreakpoint(rx[k], rd[k]);
+    return result;
+}
+
+}
+
+#endif
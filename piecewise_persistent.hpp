@@ -0,0 +1,264 @@
+#ifndef PIECEWISE_PERSISTENT_HPP
+#define PIECEWISE_PERSISTENT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "piecewise_map.hpp"
+#include "piecewise_small.hpp"
+
+namespace persistent_version {
+
+// Fonction linéaire par morceaux persistante : les versions partagent leurs noeuds.
+//
+// La fonction est stockée comme une suite d'événements (x_i, saut J_i, changement de pente S_i),
+// la même décomposition que map_version::sum_all :  f(x) = sum_{x_i <= x} J_i + S_i (x - x_i).
+// Ajouter un profil g de k breakpoints n'ajoute ou ne modifie que ses k événements : les points
+// de f dans la fenêtre de g ne sont pas touchés (contrairement aux deltaY de map_version).
+//
+// Les événements sont rangés dans un treap dont les noeuds ne sont jamais modifiés une fois
+// publiés : une écriture recopie le chemin de la racine au noeud (O(log n) noeuds neufs) et
+// partage tout le reste avec la version précédente. Copier une fonction (snapshot) est O(1).
+// Chaque noeud résume son sous-arbre par (c, A, S) : sa contribution vaut A + S (x - c) pour
+// x >= c, c étant sa plus grande abscisse ; evaluate combine O(log n) résumés. Les résumés sont
+// des valeurs de fonction, pas des moments sum S_i x_i : pas de compensation catastrophique
+// sur les grands horizons.
+//
+// Comme après sum_all, la fonction vaut 0 avant son premier événement et reste constante après
+// le dernier (pente totale nulle).
+//
+// Différence avec map_version : le premier deltaY non nul d'un profil ajouté reste ici un vrai
+// saut (0 juste avant, la valeur pleine à son abscisse). Une map ne peut représenter un saut
+// qu'à son premier point : map_version::sum (comme sum_all) le relie par un segment au point
+// précédent du résultat. Dès qu'un profil ajouté commence avant un tel saut, les valeurs
+// diffèrent donc sur ce segment ; ailleurs elles sont identiques aux arrondis près.
+class PiecewiseLinearFunction {
+    struct Node;
+    using NodePtr = std::shared_ptr<Node>;
+
+    // Contribution d'un ensemble d'événements consécutifs : A + S (x - c) pour x >= c
+    struct Summary {
+        double c, value, slope;
+    };
+
+    // Enchaîne deux résumés (b commence après a)
+    static Summary combine(const Summary& a, const Summary& b) {
+        return {b.c, a.value + a.slope * (b.c - a.c) + b.value, a.slope + b.slope};
+    }
+
+    struct Node {
+        double x, jump, dslope;
+        Summary sub;   // résumé du sous-arbre
+        uint64_t prio;
+        uint32_t size;
+        NodePtr left, right;
+
+        Summary own() const { return {x, jump, dslope}; }
+    };
+
+    NodePtr root;
+
+public:
+    PiecewiseLinearFunction() = default;
+
+    // Conversion depuis map_version : O(n log n)
+    explicit PiecewiseLinearFunction(const map_version::PiecewiseLinearFunction& f) { sum(f); }
+
+    // O(1) : la copie partage tout l'arbre
+    PiecewiseLinearFunction snapshot() const { return *this; }
+
+    size_t size() const { return count(root); }
+
+    double evaluate(double x) const {
+        Summary acc{0.0, 0.0, 0.0};
+        bool any = false;
+        auto add = [&](const Summary& s) {
+            acc = any ? combine(acc, s) : s;
+            any = true;
+        };
+        const Node* t = root.get();
+        while (t) {
+            if (t->x <= x) {
+                if (t->left) add(t->left->sub);
+                add(t->own());
+                t = t->right.get();
+            } else {
+                t = t->left.get();
+            }
+        }
+        return any ? acc.value + acc.slope * (x - acc.c) : 0.0;
+    }
+
+    // Ajoute un saut et un changement de pente en x (un événement nul disparaît)
+    void addEvent(double x, double jump, double dslope) {
+        if (jump == 0.0 && dslope == 0.0) return;
+        root = insert(root, x, jump, dslope, priority(x));
+    }
+
+    // f += g : O(k log n) noeuds recopiés pour un g de k breakpoints
+    void sum(const map_version::PiecewiseLinearFunction& g) { sumPoints(g.begin(), g.end()); }
+
+    template<size_t N>
+    void sum(const small_version::SmallPiecewise<N>& g) { sumPoints(g.begin(), g.end()); }
+
+    void sum(const PiecewiseLinearFunction& g) {
+        forEach(g.root.get(), [&](const Node& n) { addEvent(n.x, n.jump, n.dslope); });
+    }
+
+    // Même découpage que map_version::sum_all : saut au premier point, puis +pente/-pente aux
+    // extrémités de chaque segment
+    template<typename It>
+    void sumPoints(It g_begin, It g_end) {
+        if (g_begin == g_end) return;
+        It it = g_begin;
+        double x_prev = it->first;
+        addEvent(x_prev, it->second, 0.0);
+        for (++it; it != g_end; ++it) {
+            double slope = it->second / (it->first - x_prev);
+            addEvent(x_prev, 0.0, slope);
+            addEvent(it->first, 0.0, -slope);
+            x_prev = it->first;
+        }
+    }
+
+    // Retour à map_version (un breakpoint par événement)
+    map_version::PiecewiseLinearFunction to_map() const {
+        map_version::PiecewiseLinearFunction f;
+        f.clear();
+        double y_prev = 0.0;
+        forEach(root.get(), [&](const Node& n) {
+            double y = evaluate(n.x);
+            f.appendBreakpoint(n.x, y - y_prev);
+            y_prev = y;
+        });
+        return f;
+    }
+
+    // Noeuds distincts utilisés par un ensemble de versions (les noeuds partagés comptent une fois)
+    friend size_t distinct_nodes(const PiecewiseLinearFunction* versions, size_t count) {
+        std::unordered_set<const Node*> seen;
+        std::vector<const Node*> stack;
+        for (size_t i = 0; i < count; ++i) {
+            if (versions[i].root) stack.push_back(versions[i].root.get());
+            while (!stack.empty()) {
+                const Node* t = stack.back();
+                stack.pop_back();
+                if (!seen.insert(t).second) continue;   // sous-arbre déjà compté
+                if (t->left) stack.push_back(t->left.get());
+                if (t->right) stack.push_back(t->right.get());
+            }
+        }
+        return seen.size();
+    }
+
+    // Octets par noeud, bloc de contrôle de make_shared compris
+    static constexpr size_t NODE_BYTES = sizeof(Node) + 2 * sizeof(long);
+
+private:
+
+    static uint32_t count(const NodePtr& t) { return t ? t->size : 0; }
+
+    // Priorité dérivée de x (splitmix64) : même ensemble de clés, même forme d'arbre
+    static uint64_t priority(double x) {
+        uint64_t z;
+        std::memcpy(&z, &x, sizeof(z));
+        z += 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Les noeuds rendus par copy()/make() ne sont pas encore publiés : on peut les modifier
+    static NodePtr copy(const NodePtr& t) { return std::make_shared<Node>(*t); }
+
+    static NodePtr make(double x, double jump, double dslope, uint64_t prio) {
+        return std::make_shared<Node>(Node{x, jump, dslope, {x, jump, dslope}, prio, 1, nullptr, nullptr});
+    }
+
+    static void update(Node& t) {
+        t.size = 1 + count(t.left) + count(t.right);
+        t.sub = t.left ? combine(t.left->sub, t.own()) : t.own();
+        if (t.right) t.sub = combine(t.sub, t.right->sub);
+    }
+
+    static NodePtr merge(const NodePtr& a, const NodePtr& b) {
+        if (!a) return b;
+        if (!b) return a;
+        NodePtr c;
+        if (a->prio > b->prio) {
+            c = copy(a);
+            c->right = merge(a->right, b);
+        } else {
+            c = copy(b);
+            c->left = merge(a, b->left);
+        }
+        update(*c);
+        return c;
+    }
+
+    // Insertion (ou cumul sur l'événement existant) par recopie du chemin
+    static NodePtr insert(const NodePtr& t, double x, double jump, double dslope, uint64_t prio) {
+        if (!t) {
+            NodePtr n = make(x, jump, dslope, prio);
+            update(*n);
+            return n;
+        }
+        if (x == t->x) {
+            double j = t->jump + jump;
+            double s = t->dslope + dslope;
+            if (j == 0.0 && s == 0.0) return merge(t->left, t->right);   // l'événement s'annule
+            NodePtr c = copy(t);
+            c->jump = j;
+            c->dslope = s;
+            update(*c);
+            return c;
+        }
+
+        NodePtr c = copy(t);
+        if (x < t->x) {
+            c->left = insert(t->left, x, jump, dslope, prio);
+            if (c->left && c->left->prio > c->prio) {   // rotation droite (c->left est neuf)
+                NodePtr l = c->left;
+                c->left = l->right;
+                update(*c);
+                l->right = c;
+                update(*l);
+                return l;
+            }
+        } else {
+            c->right = insert(t->right, x, jump, dslope, prio);
+            if (c->right && c->right->prio > c->prio) {   // rotation gauche
+                NodePtr r = c->right;
+                c->right = r->left;
+                update(*c);
+                r->left = c;
+                update(*r);
+                return r;
+            }
+        }
+        update(*c);
+        return c;
+    }
+
+    // Parcours infixe (x croissants)
+    template<typename Visit>
+    static void forEach(const Node* t, Visit visit) {
+        std::vector<const Node*> stack;
+        while (t || !stack.empty()) {
+            while (t) {
+                stack.push_back(t);
+                t = t->left.get();
+            }
+            t = stack.back();
+            stack.pop_back();
+            visit(*t);
+            t = t->right.get();
+        }
+    }
+};
+
+}
+
+#endif
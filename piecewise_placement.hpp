@@ -0,0 +1,224 @@
+#ifndef PIECEWISE_PLACEMENT_HPP
+#define PIECEWISE_PLACEMENT_HPP
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "piecewise_map.hpp"
+
+namespace placement {
+
+// Recherche du premier instant de début réalisable d'une tâche, sans modifier le profil.
+//
+// La tâche a la forme de delta_profile(gap, t + a, t + b, t + c) : 0 en t + a, montée jusqu'à gap
+// en t + b, retour à 0 en t + c. Elle est réalisable en t si profile + tâche <= capacity partout
+// où la tâche est non nulle, c'est-à-dire T(x - t) <= max(s(x), 0) avec s = capacity - profile
+// (un dépassement déjà présent là où la tâche vaut 0 ne lui est pas imputé).
+//
+// s - T est linéaire par morceaux : son minimum sur la fenêtre est atteint en un sommet de s
+// (breakpoint de l'un des deux profils, ou passage de s par 0) ou au sommet t + b de la tâche.
+// Chaque sommet x_k en défaut interdit tout un intervalle de débuts, qui finit quand x_k arrive
+// sur la rampe montante à la hauteur s(x_k) ; un sommet de tâche trop haut interdit les débuts
+// jusqu'à ce que s remonte à gap. On saute directement à la fin de l'intervalle interdit le plus
+// lointain : t ne fait qu'avancer, et les sommets de s sont produits une seule fois, par un
+// parcours fusionné des deux profils à partir de release (seuls ceux de la fenêtre courante sont
+// gardés). Le point de départ coûte deux evaluate : O(log n) si les profils sont indexés.
+
+struct TaskShape {
+    double gap;       // hauteur du pic
+    double a, b, c;   // décalages depuis le début, a < b < c
+};
+
+namespace detail {
+
+// Parcours des breakpoints d'un profil, avec sa valeur (0 avant le premier, constante après le dernier)
+template<typename X>
+struct Walker {
+    using Iterator = typename map_version::BasicPiecewiseLinearFunction<X>::const_iterator;
+
+    Iterator next, end;
+    double x_prev = 0.0, y_prev = 0.0;
+    bool started = false;
+
+    // Positionné sur le premier breakpoint >= x
+    Walker(const map_version::BasicPiecewiseLinearFunction<X>& f, double x)
+        : next(f.lowerBound(static_cast<X>(x))), end(f.end()) {
+        if (next != f.begin()) {
+            x_prev = static_cast<double>(std::prev(next)->first);
+            y_prev = f.evaluate(std::prev(next)->first);
+            started = true;
+        }
+    }
+
+    bool done() const { return next == end; }
+    double nextX() const { return static_cast<double>(next->first); }
+
+    // valeur en x, x_prev <= x <= nextX()
+    double value(double x) const {
+        if (!started) return 0.0;
+        if (next == end) return y_prev;
+        return y_prev + next->second * (x - x_prev) / (nextX() - x_prev);
+    }
+
+    void consume() {
+        x_prev = nextX();
+        y_prev += next->second;
+        started = true;
+        ++next;
+    }
+};
+
+// Sommets (x, s(x)) de s = capacity - profile à partir de x0 (premier sommet en x0), dans l'ordre
+// croissant, passages par 0 compris. Un saut (premier breakpoint d'un profil) donne deux sommets
+// de même x : valeur avant, valeur après.
+template<typename X>
+class Slack {
+public:
+    Slack(const map_version::BasicPiecewiseLinearFunction<X>& profile,
+          const map_version::BasicPiecewiseLinearFunction<X>& capacity, double x0,
+          std::vector<std::pair<double, double>>& out)
+        : f(profile, x0), cap(capacity, x0) {
+        push(out, x0, cap.value(x0) - f.value(x0));
+    }
+
+    bool exhausted() const { return f.done() && cap.done(); }
+
+    // Ajoute à out les sommets de la prochaine abscisse ; false si les deux profils sont épuisés
+    bool pull(std::vector<std::pair<double, double>>& out) {
+        if (exhausted()) return false;
+        double x = f.done() ? cap.nextX() : cap.done() ? f.nextX() : std::min(f.nextX(), cap.nextX());
+        double before = cap.value(x) - f.value(x);
+        bool jump = false;
+        if (!f.done() && f.nextX() == x) {
+            jump |= !f.started;
+            f.consume();
+        }
+        if (!cap.done() && cap.nextX() == x) {
+            jump |= !cap.started;
+            cap.consume();
+        }
+        double after = cap.value(x) - f.value(x);
+        if (jump) push(out, x, before);
+        push(out, x, after);
+        return true;
+    }
+
+private:
+    Walker<X> f, cap;
+    bool any = false;
+    std::pair<double, double> last;
+
+    void push(std::vector<std::pair<double, double>>& out, double x, double v) {
+        if (any && x > last.first && ((last.second < 0.0 && v > 0.0) || (last.second > 0.0 && v < 0.0))) {
+            double xz = last.first + (x - last.first) * last.second / (last.second - v);
+            out.emplace_back(xz, 0.0);
+        }
+        out.emplace_back(x, v);
+        last = {x, v};
+        any = true;
+    }
+};
+
+}
+
+// Premier début t >= release réalisable pour la tâche ; +infini s'il n'y en a pas (la marge reste
+// sous gap après le dernier breakpoint). Pour des abscisses entières, t peut être fractionnaire.
+template<typename X>
+double earliest_start(const map_version::BasicPiecewiseLinearFunction<X>& profile, const TaskShape& task,
+                      const map_version::BasicPiecewiseLinearFunction<X>& capacity, double release) {
+    const double inf = std::numeric_limits<double>::infinity();
+    const double tol = map_version::EPSILON;
+    const double gap = task.gap, a = task.a, b = task.b, c = task.c;
+    if (gap <= 0.0) return release;
+
+    std::vector<std::pair<double, double>> vertices;   // sommets de s, à partir de head
+    size_t head = 0;
+    detail::Slack<X> slack(profile, capacity, release + a, vertices);
+
+    // s(x) par interpolation entre les sommets gardés (constante avant le premier, après le dernier)
+    auto slackAt = [&](double x) {
+        if (x <= vertices[head].first) return vertices[head].second;
+        auto it = std::upper_bound(vertices.begin() + head, vertices.end(), x,
+                                   [](double v, const std::pair<double, double>& p) { return v < p.first; });
+        if (it == vertices.end()) return vertices.back().second;
+        auto prev = std::prev(it);
+        return prev->second + (it->second - prev->second) * (x - prev->first) / (it->first - prev->first);
+    };
+
+    // hauteur de la tâche à u du début
+    auto height = [&](double u) {
+        if (u <= a || u >= c) return 0.0;
+        return u <= b ? gap * (u - a) / (b - a) : gap * (c - u) / (c - b);
+    };
+
+    double t = release;
+    while (true) {
+        // fenêtre [t + a, t + c] : le dernier sommet <= t + a sert à l'interpolation
+        while (vertices.back().first < t + c && slack.pull(vertices)) {}
+        while (head + 1 < vertices.size() && vertices[head + 1].first <= t + a) ++head;
+        if (head > 1024 && head * 2 > vertices.size()) {
+            vertices.erase(vertices.begin(), vertices.begin() + head);
+            head = 0;
+        }
+
+        // sommet de la tâche : avancer jusqu'à ce que s remonte à gap
+        double xb = t + b;
+        if (slackAt(xb) < gap - tol) {
+            size_t k = head;
+            while (k + 1 < vertices.size() && vertices[k + 1].first <= xb) ++k;
+            double xg = inf;
+            while (true) {
+                if (k + 1 == vertices.size() && !slack.pull(vertices)) break;   // s constante < gap
+                const auto& p = vertices[k];
+                const auto& q = vertices[k + 1];
+                if (q.second >= gap - tol) {
+                    xg = q.first == p.first || p.second >= gap - tol || q.second <= gap
+                             ? q.first
+                             : p.first + (q.first - p.first) * (gap - p.second) / (q.second - p.second);
+                    xg = std::max(xg, xb);
+                    break;
+                }
+                ++k;
+            }
+            if (xg == inf) return inf;
+            // xg > xb à l'arrondi près : garantir l'avancée
+            t = xg - b > t ? xg - b : std::nextafter(t, inf);
+            continue;
+        }
+
+        // sommets de s dans la fenêtre
+        double next_t = t;
+        for (size_t k = head; k < vertices.size() && vertices[k].first < t + c; ++k) {
+            double x = vertices[k].first;
+            if (x <= t + a) continue;
+            double room = std::max(vertices[k].second, 0.0);
+            if (height(x - t) > room + tol) {
+                next_t = std::max(next_t, x - (a + (b - a) * room / gap));
+            }
+        }
+        if (next_t == t) return t;
+        t = next_t;
+    }
+}
+
+// Même recherche par essais : sum de la tâche en chaque candidat release, release + step, ...,
+// vérification sur la fenêtre puis restore. profile doit être indexé (enableIndex) et capacity
+// constante sur les fenêtres essayées. Référence des benchmarks ; max_tries essais au plus.
+template<typename X>
+double earliest_start_by_trial(map_version::BasicPiecewiseLinearFunction<X>& profile, const TaskShape& task,
+                               double capacity, double release, double step, size_t max_tries) {
+    for (size_t i = 0; i < max_tries; ++i) {
+        double t = release + step * static_cast<double>(i);
+        size_t mark = profile.checkpoint();
+        profile.sum(map_version::delta_profile<X>(task.gap, t + task.a, t + task.b, t + task.c));
+        bool fits = profile.maxOver(t + task.a, t + task.c) <= capacity + map_version::EPSILON;
+        profile.restore(mark);
+        if (fits) return t;
+    }
+    return std::numeric_limits<double>::infinity();
+}
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef PIECEWISE_SIMD_HPP
+#define PIECEWISE_SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Noyaux d'évaluation par lots sur des tableaux contigus, partagés par les trois versions.
+//
+// - requêtes triées : une seule passe de fusion (l'indice courant ne fait qu'avancer) ;
+// - requêtes quelconques : recherche dichotomique sans branchement, 4 requêtes à la fois avec
+//   AVX2 (gather + comparaison vectorielle), puis interpolation vectorielle ; repli scalaire sinon.
+//
+// Les opérations flottantes sont exactement celles de l'évaluation scalaire (soustraction,
+// division, multiplication, addition, dans le même ordre) : les résultats sont identiques bit
+// à bit tant que le compilateur ne fusionne pas mul+add en FMA (-ffp-contract=off si -mfma).
+
+namespace simd {
+
+// Nombre d'abscisses bx[j] telles que bx[j] + eps < x (lower_bound sans branchement)
+inline size_t count_below(const double* bx, size_t n, double x, double eps) {
+    const double* base = bx;
+    size_t len = n;
+    while (len > 1) {
+        size_t half = len / 2;
+        base += (base[half] + eps < x) ? half : 0;
+        len -= half;
+    }
+    return static_cast<size_t>(base - bx) + (base[0] + eps < x);
+}
+
+// Même convention que map_version::eval : 0 avant le premier point, dernier y après le dernier,
+// interpolation sur le premier segment [bx[i-1], bx[i]] (i >= 1) tel que x <= bx[i] + eps
+inline double interpolate_at(const double* bx, const double* by, size_t n, double x, size_t i) {
+    if (x < bx[0]) return 0.0;
+    if (i == 0) i = 1;
+    if (i >= n) return by[n - 1];
+    double slope = (by[i] - by[i - 1]) / (bx[i] - bx[i - 1]);
+    return by[i - 1] + slope * (x - bx[i - 1]);
+}
+
+// Évalue la fonction définie par les points (bx, by) (valeurs absolues) aux q abscisses xs
+inline void interpolate_many(const double* bx, const double* by, size_t n,
+                             const double* xs, double* out, size_t q, double eps) {
+    if (n == 0) {
+        std::fill(out, out + q, 0.0);
+        return;
+    }
+    if (n == 1) {
+        for (size_t k = 0; k < q; ++k) out[k] = (xs[k] < bx[0]) ? 0.0 : by[0];
+        return;
+    }
+
+    if (std::is_sorted(xs, xs + q)) {
+        size_t i = 0;
+        for (size_t k = 0; k < q; ++k) {
+            while (i < n && bx[i] + eps < xs[k]) ++i;
+            out[k] = interpolate_at(bx, by, n, xs[k], i);
+        }
+        return;
+    }
+
+    size_t k = 0;
+#if defined(__AVX2__)
+    const __m256d veps = _mm256_set1_pd(eps);
+    const __m256d vfirst = _mm256_set1_pd(bx[0]);
+    const __m256d vlast = _mm256_set1_pd(by[n - 1]);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i vlast_index = _mm256_set1_epi64x(static_cast<long long>(n - 1));
+    const double* bx_d = bx;
+    for (; k + 4 <= q; k += 4) {
+        __m256d key = _mm256_loadu_pd(xs + k);
+
+        // recherche : les 4 voies partagent la même suite de longueurs
+        __m256i base = _mm256_setzero_si256();
+        size_t len = n;
+        while (len > 1) {
+            size_t half = len / 2;
+            __m256d v = _mm256_i64gather_pd(bx_d + half, base, 8);
+            __m256d lt = _mm256_cmp_pd(_mm256_add_pd(v, veps), key, _CMP_LT_OQ);
+            base = _mm256_add_epi64(base, _mm256_and_si256(_mm256_castpd_si256(lt),
+                                                           _mm256_set1_epi64x(static_cast<long long>(half))));
+            len -= half;
+        }
+        __m256d v = _mm256_i64gather_pd(bx_d, base, 8);
+        __m256d lt = _mm256_cmp_pd(_mm256_add_pd(v, veps), key, _CMP_LT_OQ);
+        __m256i idx = _mm256_add_epi64(base, _mm256_and_si256(_mm256_castpd_si256(lt), one));
+
+        // i = clamp(idx, 1, n-1) ; les voies idx >= n prennent le dernier y
+        __m256i tail = _mm256_cmpgt_epi64(idx, vlast_index);
+        __m256i zero = _mm256_cmpeq_epi64(idx, _mm256_setzero_si256());
+        idx = _mm256_blendv_epi8(idx, one, zero);
+        idx = _mm256_blendv_epi8(idx, vlast_index, tail);
+        __m256i idx0 = _mm256_sub_epi64(idx, one);
+
+        __m256d x0 = _mm256_i64gather_pd(bx, idx0, 8);
+        __m256d x1 = _mm256_i64gather_pd(bx, idx, 8);
+        __m256d y0 = _mm256_i64gather_pd(by, idx0, 8);
+        __m256d y1 = _mm256_i64gather_pd(by, idx, 8);
+
+        __m256d slope = _mm256_div_pd(_mm256_sub_pd(y1, y0), _mm256_sub_pd(x1, x0));
+        __m256d r = _mm256_add_pd(y0, _mm256_mul_pd(slope, _mm256_sub_pd(key, x0)));
+        r = _mm256_blendv_pd(r, vlast, _mm256_castsi256_pd(tail));
+        __m256d before = _mm256_cmp_pd(key, vfirst, _CMP_LT_OQ);
+        r = _mm256_blendv_pd(r, _mm256_setzero_pd(), before);
+        _mm256_storeu_pd(out + k, r);
+    }
+#endif
+    for (; k < q; ++k) {
+        out[k] = interpolate_at(bx, by, n, xs[k], count_below(bx, n, xs[k], eps));
+    }
+}
+
+// Version segments (list_version) : segment j = [xl[j], xr[j]] de pente slope[j] précalculée.
+// On prend le premier segment tel que x <= xr[j] ; hors des segments la valeur est 0.
+inline void segments_many(const double* xl, const double* yl, const double* xr, const double* slope,
+                          size_t m, const double* xs, double* out, size_t q) {
+    auto at = [&](double x, size_t j) {
+        if (j >= m || x < xl[j]) return 0.0;
+        return yl[j] + slope[j] * (x - xl[j]);
+    };
+
+    if (m == 0) {
+        std::fill(out, out + q, 0.0);
+        return;
+    }
+
+    if (std::is_sorted(xs, xs + q)) {
+        size_t j = 0;
+        for (size_t k = 0; k < q; ++k) {
+            while (j < m && xr[j] < xs[k]) ++j;
+            out[k] = at(xs[k], j);
+        }
+        return;
+    }
+
+    size_t k = 0;
+#if defined(__AVX2__)
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i vlast_index = _mm256_set1_epi64x(static_cast<long long>(m - 1));
+    for (; k + 4 <= q; k += 4) {
+        __m256d key = _mm256_loadu_pd(xs + k);
+
+        __m256i base = _mm256_setzero_si256();
+        size_t len = m;
+        while (len > 1) {
+            size_t half = len / 2;
+            __m256d v = _mm256_i64gather_pd(xr + half, base, 8);
+            __m256d lt = _mm256_cmp_pd(v, key, _CMP_LT_OQ);
+            base = _mm256_add_epi64(base, _mm256_and_si256(_mm256_castpd_si256(lt),
+                                                           _mm256_set1_epi64x(static_cast<long long>(half))));
+            len -= half;
+        }
+        __m256d v = _mm256_i64gather_pd(xr, base, 8);
+        __m256d lt = _mm256_cmp_pd(v, key, _CMP_LT_OQ);
+        __m256i idx = _mm256_add_epi64(base, _mm256_and_si256(_mm256_castpd_si256(lt), one));
+
+        __m256i outside = _mm256_cmpgt_epi64(idx, vlast_index);
+        idx = _mm256_blendv_epi8(idx, vlast_index, outside);
+
+        __m256d x0 = _mm256_i64gather_pd(xl, idx, 8);
+        __m256d y0 = _mm256_i64gather_pd(yl, idx, 8);
+        __m256d s = _mm256_i64gather_pd(slope, idx, 8);
+        __m256d r = _mm256_add_pd(y0, _mm256_mul_pd(s, _mm256_sub_pd(key, x0)));
+
+        __m256d out_mask = _mm256_or_pd(_mm256_castsi256_pd(outside), _mm256_cmp_pd(key, x0, _CMP_LT_OQ));
+        r = _mm256_blendv_pd(r, _mm256_setzero_pd(), out_mask);
+        _mm256_storeu_pd(out + k, r);
+    }
+#endif
+    for (; k < q; ++k) {
+        // premier segment tel que xs[k] <= xr[j]
+        const double* base = xr;
+        size_t len = m;
+        while (len > 1) {
+            size_t half = len / 2;
+            base += (base[half] < xs[k]) ? half : 0;
+            len -= half;
+        }
+        size_t j = static_cast<size_t>(base - xr) + (base[0] < xs[k]);
+        out[k] = at(xs[k], j);
+    }
+}
+
+}
+
+#endif
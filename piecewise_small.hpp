@@ -0,0 +1,66 @@
+#ifndef PIECEWISE_SMALL_HPP
+#define PIECEWISE_SMALL_HPP
+
+#include <cstddef>
+#include <utility>
+
+namespace small_version {
+
+// Profil de tâche de taille fixe, entièrement sur la pile : au plus N breakpoints (x, deltaY),
+// mêmes conventions que map_version (0 avant le premier point, constant après le dernier).
+// Construit par des fabriques constexpr, il s'ajoute directement à un grand profil
+// (map_version::sum, list_version::add) sans passer par une map ou des segments alloués.
+template<size_t N>
+struct SmallPiecewise {
+    std::pair<double, double> points[N];   // (x, deltaY), x strictement croissant
+    size_t count;
+
+    constexpr const std::pair<double, double>* begin() const { return points; }
+    constexpr const std::pair<double, double>* end() const { return points + count; }
+    constexpr size_t size() const { return count; }
+
+    // valeur au i-ème point
+    constexpr double valueAt(size_t i) const {
+        double y = 0.0;
+        for (size_t k = 0; k <= i; ++k) y += points[k].second;
+        return y;
+    }
+
+    // Valeur en x (même interpolation que map_version::eval, sans tolérance)
+    constexpr double evaluate(double x) const {
+        if (count == 0 || x < points[0].first) return 0.0;
+        double y_prev = points[0].second;
+        for (size_t i = 1; i < count; ++i) {
+            double y_curr = y_prev + points[i].second;
+            if (x <= points[i].first) {
+                double slope = (y_curr - y_prev) / (points[i].first - points[i - 1].first);
+                return y_prev + slope * (x - points[i - 1].first);
+            }
+            y_prev = y_curr;
+        }
+        return y_prev;
+    }
+
+    // Limite à gauche en x : 0 jusqu'au premier point inclus, valeur ordinaire ensuite
+    constexpr double leftLimit(double x) const {
+        if (count == 0 || x <= points[0].first) return 0.0;
+        return evaluate(x);
+    }
+};
+
+//=================================================================================================================
+//======================================  Construction profile delta function =====================================
+//=================================================================================================================
+// Mêmes profils que map_version::delta_profile / cba_profile, pour 0 <= a < b (< c)
+
+constexpr SmallPiecewise<3> delta_profile(double gap, double a, double b, double c) {
+    return SmallPiecewise<3>{{{a, 0.0}, {b, gap}, {c, -gap}}, 3};
+}
+
+constexpr SmallPiecewise<2> cba_profile(double cap, double a, double b) {
+    return SmallPiecewise<2>{{{a, 0.0}, {b, cap}}, 2};
+}
+
+}
+
+#endif
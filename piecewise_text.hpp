@@ -0,0 +1,128 @@
+#ifndef PIECEWISE_TEXT_HPP
+#define PIECEWISE_TEXT_HPP
+
+#include <charconv>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// Entrées/sorties texte rapides des profils : une ligne "x y" (exportFunction) ou "x,y"
+// (export_to_csv) par point.
+//
+// Écriture : std::to_chars dans un tampon de 1 Mio vidé par blocs (représentation la plus courte
+// qui se relit exactement). Lecture : le fichier est chargé en une fois puis analysé par
+// std::from_chars, sans flux ni locale. Le séparateur (espaces, tabulation ou virgule) est
+// détecté sur chaque ligne, les deux formats se relisent donc avec le même lecteur.
+
+namespace text {
+
+class Writer {
+public:
+    explicit Writer(const std::string& filename) : file(std::fopen(filename.c_str(), "wb")), buffer(CAPACITY) {
+        pos = buffer.data();
+    }
+
+    ~Writer() { close(); }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    bool ok() const { return file != nullptr; }
+
+    // Une ligne "x<sep>y\n"
+    void point(double x, double y, char sep) {
+        if (buffer.data() + CAPACITY - pos < MAX_LINE_BYTES) flush();
+        pos = std::to_chars(pos, buffer.data() + CAPACITY, x).ptr;
+        *pos++ = sep;
+        pos = std::to_chars(pos, buffer.data() + CAPACITY, y).ptr;
+        *pos++ = '\n';
+    }
+
+    void flush() {
+        if (file && pos != buffer.data()) {
+            size_t n = static_cast<size_t>(pos - buffer.data());
+            std::fwrite(buffer.data(), 1, n, file);
+            written += n;
+        }
+        pos = buffer.data();
+    }
+
+    void close() {
+        flush();
+        if (file) std::fclose(file);
+        file = nullptr;
+    }
+
+    size_t bytes() const { return written + static_cast<size_t>(pos - buffer.data()); }
+
+private:
+    static constexpr size_t CAPACITY = 1 << 20;
+    static constexpr ptrdiff_t MAX_LINE_BYTES = 64;   // deux double (24 caractères max) et deux séparateurs
+
+    std::FILE* file;
+    std::vector<char> buffer;
+    char* pos;
+    size_t written = 0;
+};
+
+class Reader {
+public:
+    // Charge tout le fichier ; std::runtime_error s'il ne peut pas être lu
+    explicit Reader(const std::string& filename) {
+        std::FILE* file = std::fopen(filename.c_str(), "rb");
+        if (!file) throw std::runtime_error("impossible d'ouvrir le fichier " + filename);
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        data.resize(size > 0 ? static_cast<size_t>(size) : 0);
+        size_t n = data.empty() ? 0 : std::fread(data.data(), 1, data.size(), file);
+        std::fclose(file);
+        if (n != data.size()) throw std::runtime_error("lecture incomplète du fichier " + filename);
+        pos = data.data();
+        end = pos + data.size();
+    }
+
+    size_t bytes() const { return data.size(); }
+
+    // Ligne suivante (les lignes vides sont ignorées) ; false en fin de fichier
+    bool next(double& x, double& y) {
+        while (pos != end && (*pos == '\n' || *pos == '\r' || *pos == ' ' || *pos == '\t')) {
+            if (*pos == '\n') ++line;
+            ++pos;
+        }
+        if (pos == end) return false;
+
+        pos = number(pos, x);
+        while (pos != end && (*pos == ' ' || *pos == '\t')) ++pos;
+        if (pos != end && *pos == ',') ++pos;
+        while (pos != end && (*pos == ' ' || *pos == '\t')) ++pos;
+        pos = number(pos, y);
+
+        while (pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) ++pos;
+        if (pos != end && *pos != '\n') fail();
+        return true;
+    }
+
+    size_t lineNumber() const { return line; }
+
+private:
+    std::vector<char> data;
+    const char* pos = nullptr;
+    const char* end = nullptr;
+    size_t line = 1;
+
+    const char* number(const char* p, double& v) {
+        auto r = std::from_chars(p, end, v);
+        if (r.ec != std::errc()) fail();
+        return r.ptr;
+    }
+
+    [[noreturn]] void fail() const {
+        throw std::runtime_error("ligne " + std::to_string(line) + " : deux nombres attendus");
+    }
+};
+
+}
+
+#endif
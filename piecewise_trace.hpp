@@ -0,0 +1,514 @@
+#ifndef PIECEWISE_TRACE_HPP
+#define PIECEWISE_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Enregistrement des appels publics de map_version::PiecewiseLinearFunction dans une trace binaire
+// compacte, et rejeu de la trace sur n'importe quel backend avec la latence de chaque opération.
+//
+// Activé à la compilation par -DPIECEWISE_TRACE (sans ce drapeau, PWL_TRACE(...) ne produit aucun
+// code et les profils n'ont pas de membre supplémentaire), puis à l'exécution par une Session qui
+// désigne le Recorder du thread courant. Chaque profil porte une Identity : un numéro stable et un
+// tampon renouvelé à chaque écriture. Seul l'appel public le plus externe est enregistré (un sum
+// qui passe par sumPoints donne un seul enregistrement). Avant d'enregistrer une opération sur un
+// profil que la trace ne connaît pas, ou qui a changé depuis par une opération non enregistrée
+// (compaction, min/max, restore, affectation...), le recorder écrit d'abord son état complet :
+// le rejeu reproduit donc toujours les mêmes entrées, quelles que soient les opérations tracées.
+//
+// Format : "PWLTRC1\0", puis des enregistrements [op : 1 octet][numéro de profil : varint][données].
+// Les abscisses et valeurs sont des double bruts (8 octets, ordre de la machine), les tailles des
+// varints. La trace ne contient que des nombres : aucune donnée métier autre que les profils.
+// Pour partager une trace de production, Anonymize masque l'origine des temps et les ordres de
+// grandeur des abscisses et des valeurs, sans changer le coût du rejeu.
+//
+// Le rejeu vérifie chaque lecture contre la taille de la trace : une trace tronquée ou corrompue
+// arrête le rejeu avec un message (Replay::error) au lieu de lire hors du tampon.
+
+namespace trace {
+
+enum class Op : uint8_t {
+    DEFINE = 0,      // état complet : n, puis n couples (x, deltaY)
+    ADD = 1,         // addBreakpoint(x, deltaY)
+    REMOVE = 2,      // removeBreakpoint(x)
+    SUM = 3,         // sum(g) : numéro de g
+    SUM_POINTS = 4,  // sum d'un profil hors map (small, vue binaire) : n couples (x, deltaY)
+    EVALUATE = 5,    // evaluate(x)
+    EVALUATE_MANY = 6,   // evaluate_many : n abscisses
+    EXPORT = 7,      // exportFunction
+    DROP = 8,        // destruction du profil
+};
+
+constexpr size_t OP_COUNT = 9;
+
+constexpr const char* OP_NAMES[OP_COUNT] = {"define", "add", "remove", "sum", "sum_points",
+                                           "evaluate", "evaluate_many", "export", "drop"};
+
+constexpr char MAGIC[8] = {'P', 'W', 'L', 'T', 'R', 'C', '1', '\0'};
+
+// Masquage des nombres écrits : abscisse x -> (x - origin) * 2^x_exponent, valeur et deltaY
+// y -> y * 2^y_exponent. Les facteurs puissances de deux sont exacts : ordre des points, nombre de
+// breakpoints et pentes relatives (donc le travail de chaque opération au rejeu) sont conservés ;
+// seule la soustraction de l'origine peut arrondir, comme un décalage de l'horizon. Choisir des
+// valeurs gardées secrètes.
+struct Anonymize {
+    double origin = 0.0;
+    int x_exponent = 0;
+    int y_exponent = 0;
+};
+
+class Recorder;
+
+inline Recorder*& active() {
+    thread_local Recorder* r = nullptr;
+    return r;
+}
+
+// Numéro et tampon d'un profil. Une copie est un nouveau profil ; une affectation ou un
+// déplacement change l'état (nouveau tampon) sans changer le numéro.
+class Identity {
+public:
+    Identity() : number(next()), stamp(next()) {}
+    Identity(const Identity&) : Identity() {}
+    Identity(Identity&& other) noexcept : Identity() { other.touch(); }
+    Identity& operator=(const Identity&) {
+        touch();
+        return *this;
+    }
+    Identity& operator=(Identity&& other) noexcept {
+        touch();
+        other.touch();
+        return *this;
+    }
+    inline ~Identity();
+
+    void touch() { stamp = next(); }
+
+    uint64_t id() const { return number; }
+    uint64_t version() const { return stamp; }
+
+private:
+    uint64_t number, stamp;
+
+    static uint64_t next() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+};
+
+// Trace en cours d'écriture (un Recorder par thread enregistré)
+class Recorder {
+public:
+    Recorder() : bytes(MAGIC, MAGIC + sizeof(MAGIC)) {}
+
+    explicit Recorder(const Anonymize& mask)
+        : bytes(MAGIC, MAGIC + sizeof(MAGIC)), mask(mask),
+          masked(mask.origin != 0.0 || mask.x_exponent != 0 || mask.y_exponent != 0) {}
+
+    const std::vector<uint8_t>& data() const { return bytes; }
+    size_t records() const { return count; }
+
+    bool save(const std::string& filename) const {
+        std::ofstream out(filename, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(out);
+    }
+
+    // Appel public le plus externe : ouvre l'enregistrement si la profondeur est nulle
+    bool enter() { return depth++ == 0; }
+    void leave() { --depth; }
+
+    // Écrit l'état complet de f si la trace ne le connaît pas dans son état courant
+    template<typename F>
+    void sync(const Identity& id, const F& f) {
+        auto it = known.find(id.id());
+        if (it != known.end() && it->second == id.version()) return;
+        size_t n = 0;
+        for (auto p = f.begin(); p != f.end(); ++p) ++n;
+        begin(Op::DEFINE, id);
+        varint(n);
+        for (const auto& p : f) {
+            abscissa(static_cast<double>(p.first));
+            value(p.second);
+        }
+        known[id.id()] = id.version();
+    }
+
+    // Après l'opération : l'état obtenu est celui que le rejeu reconstruit
+    void settle(const Identity& id) { known[id.id()] = id.version(); }
+
+    void drop(const Identity& id) {
+        if (known.erase(id.id()) > 0) begin(Op::DROP, id);
+    }
+
+    void begin(Op op, const Identity& id) {
+        bytes.push_back(static_cast<uint8_t>(op));
+        varint(id.id());
+        ++count;
+    }
+
+    void varint(uint64_t v) {
+        while (v >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(v));
+    }
+
+    void f64(double v) {
+        size_t at = bytes.size();
+        bytes.resize(at + 8);
+        std::memcpy(bytes.data() + at, &v, 8);
+    }
+
+    // Abscisse et valeur (ou deltaY), masquées si la trace est anonymisée
+    void abscissa(double x) { f64(masked ? std::ldexp(x - mask.origin, mask.x_exponent) : x); }
+    void value(double y) { f64(masked ? std::ldexp(y, mask.y_exponent) : y); }
+
+private:
+    std::vector<uint8_t> bytes;
+    Anonymize mask;
+    bool masked = false;
+    std::unordered_map<uint64_t, uint64_t> known;   // numéro -> tampon de l'état écrit
+    size_t count = 0;
+    int depth = 0;
+};
+
+inline Identity::~Identity() {
+    if (Recorder* r = active()) r->drop(*this);
+}
+
+// Désigne le Recorder du thread courant pendant sa durée de vie
+class Session {
+public:
+    explicit Session(Recorder& r) : previous(active()) { active() = &r; }
+    ~Session() { active() = previous; }
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+private:
+    Recorder* previous;
+};
+
+// Portée d'un appel public : seul le plus externe écrit ; à la sortie, l'état du profil est noté
+class Call {
+public:
+    explicit Call(const Identity& id) : r(active()), id(&id), outer(r && r->enter()) {}
+    ~Call() {
+        if (!r) return;
+        if (outer) r->settle(*id);
+        r->leave();
+    }
+    Call(const Call&) = delete;
+    Call& operator=(const Call&) = delete;
+
+    // nullptr si aucune trace n'est active ou si l'appel est imbriqué dans un appel enregistré
+    Recorder* recorder() const { return outer ? r : nullptr; }
+
+private:
+    Recorder* r;
+    const Identity* id;
+    bool outer;
+};
+
+// Enregistrements des opérations (appelés depuis map_version par PWL_TRACE(op, *this, ...))
+template<typename F>
+void add(const Call& call, const Identity& id, const F& f, double x, double deltaY) {
+    if (Recorder* r = call.recorder()) {
+        r->sync(id, f);
+        r->begin(Op::ADD, id);
+        r->abscissa(x);
+        r->value(deltaY);
+    }
+}
+
+template<typename F>
+void remove(const Call& call, const Identity& id, const F& f, double x) {
+    if (Recorder* r = call.recorder()) {
+        r->sync(id, f);
+        r->begin(Op::REMOVE, id);
+        r->abscissa(x);
+    }
+}
+
+template<typename F>
+void sum(const Call& call, const Identity& id, const F& f, const Identity& gid, const F& g) {
+    if (Recorder* r = call.recorder()) {
+        r->sync(id, f);
+        r->sync(gid, g);
+        r->begin(Op::SUM, id);
+        r->varint(gid.id());
+    }
+}
+
+template<typename F, typename It>
+void sumPoints(const Call& call, const Identity& id, const F& f, It g_begin, It g_end) {
+    if (Recorder* r = call.recorder()) {
+        r->sync(id, f);
+        size_t n = 0;
+        for (It it = g_begin; it != g_end; ++it) ++n;
+        r->begin(Op::SUM_POINTS, id);
+        r->varint(n);
+        for (It it = g_begin; it != g_end; ++it) {
+            r->abscissa(static_cast<double>(it->first));
+            r->value(it->second);
+        }
+    }
+}
+
+template<typename F>
+void evaluate(const Call& call, const Identity& id, const F& f, double x) {
+    if (Recorder* r = call.recorder()) {
+        r->sync(id, f);
+        r->begin(Op::EVALUATE, id);
+        r->abscissa(x);
+    }
+}
+
+template<typename F>
+void evaluateMany(const Call& call, const Identity& id, const F& f, const double* xs, size_t count) {
+    if (Recorder* r = call.recorder()) {
+        r->sync(id, f);
+        r->begin(Op::EVALUATE_MANY, id);
+        r->varint(count);
+        for (size_t k = 0; k < count; ++k) r->abscissa(xs[k]);
+    }
+}
+
+template<typename F>
+void exportFunction(const Call& call, const Identity& id, const F& f) {
+    if (Recorder* r = call.recorder()) {
+        r->sync(id, f);
+        r->begin(Op::EXPORT, id);
+    }
+}
+
+//======================================================================================================
+//==========================                     Rejeu                  ================================
+//======================================================================================================
+
+// Lecture séquentielle d'une trace. Une lecture au-delà de la fin (ou un code d'opération
+// inconnu) met le Reader en échec : les lectures suivantes rendent 0 et done() devient vrai.
+class Reader {
+public:
+    explicit Reader(std::vector<uint8_t> data) : bytes(std::move(data)) {
+        valid = bytes.size() >= sizeof(MAGIC) && std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) == 0;
+        pos = sizeof(MAGIC);
+    }
+
+    static Reader load(const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return Reader(std::move(data));
+    }
+
+    bool ok() const { return valid; }
+    bool failed() const { return broken; }
+    bool done() const { return !valid || broken || pos >= bytes.size(); }
+    size_t size() const { return bytes.size(); }
+    size_t position() const { return pos; }
+
+    Op op() {
+        if (!need(1)) return Op::DROP;
+        uint8_t code = bytes[pos++];
+        if (code >= OP_COUNT) {
+            fail();
+            return Op::DROP;
+        }
+        return static_cast<Op>(code);
+    }
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!need(1)) return 0;
+            uint8_t b = bytes[pos++];
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        fail();   // plus de 10 octets : varint corrompu
+        return 0;
+    }
+
+    double f64() {
+        if (!need(8)) return 0.0;
+        double v;
+        std::memcpy(&v, bytes.data() + pos, 8);
+        pos += 8;
+        return v;
+    }
+
+    // Échec si la trace ne contient plus count éléments de each octets (taille lue avant un tableau)
+    void expect(uint64_t count, size_t each) {
+        if (!broken && count > (bytes.size() - pos) / each) fail();
+    }
+
+private:
+    std::vector<uint8_t> bytes;
+    size_t pos = 0;
+    bool valid = false;
+    bool broken = false;
+
+    bool need(size_t n) {
+        if (broken || bytes.size() - pos < n) {
+            fail();
+            return false;
+        }
+        return true;
+    }
+
+    void fail() { broken = true; }
+};
+
+// Latences (ns) de chaque opération rejouée, et somme des valeurs évaluées pour comparer les
+// backends entre eux
+struct Replay {
+    std::vector<double> latency_ns[OP_COUNT];
+    double checksum = 0.0;
+    size_t operations = 0;
+    std::string error;   // vide si la trace a été rejouée en entier
+};
+
+// Rejoue la trace sur le backend F (map_version, flat_version... : clear, addBreakpoint,
+// removeBreakpoint, sum, evaluate, evaluate_many, to_points_cumulative). Les DEFINE et les profils
+// de SUM_POINTS sont construits hors chronométrage ; EXPORT est rejoué par to_points_cumulative
+// (même parcours, sans écriture sur disque).
+template<typename F>
+Replay replay(Reader trace) {
+    using Clock = std::chrono::steady_clock;
+    Replay result;
+    std::unordered_map<uint64_t, F> profiles;
+    std::vector<double> xs, out;
+
+    auto build = [&](Reader& in, size_t n) {
+        F f;
+        f.clear();
+        for (size_t k = 0; k < n; ++k) {
+            double x = in.f64();
+            f.addBreakpoint(x, in.f64());
+        }
+        return f;
+    };
+    auto timed = [&](Op op, auto&& run) {
+        auto start = Clock::now();
+        run();
+        auto stop = Clock::now();
+        result.latency_ns[static_cast<size_t>(op)].push_back(
+            static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()));
+        ++result.operations;
+    };
+
+    // enregistrement incomplet : rien n'est exécuté avec des opérandes lus hors de la trace
+    auto truncated = [&](size_t at) {
+        if (!trace.failed()) return false;
+        result.error = "trace tronquée ou corrompue (enregistrement à l'octet " + std::to_string(at) + ")";
+        return true;
+    };
+
+    while (!trace.done()) {
+        size_t at = trace.position();
+        Op op = trace.op();
+        uint64_t id = trace.varint();
+        if (truncated(at)) break;
+        switch (op) {
+        case Op::DEFINE: {
+            size_t n = trace.varint();
+            trace.expect(n, 16);
+            if (truncated(at)) break;
+            profiles[id] = build(trace, n);
+            break;
+        }
+        case Op::ADD: {
+            double x = trace.f64(), d = trace.f64();
+            if (truncated(at)) break;
+            F& f = profiles[id];
+            timed(op, [&] { f.addBreakpoint(x, d); });
+            break;
+        }
+        case Op::REMOVE: {
+            double x = trace.f64();
+            if (truncated(at)) break;
+            F& f = profiles[id];
+            timed(op, [&] { f.removeBreakpoint(x); });
+            break;
+        }
+        case Op::SUM: {
+            uint64_t gid = trace.varint();
+            if (truncated(at)) break;
+            F& f = profiles[id];
+            const F& g = profiles[gid];
+            if (gid == id) {
+                F copy = g;
+                timed(op, [&] { f.sum(copy); });
+            } else {
+                timed(op, [&] { f.sum(g); });
+            }
+            break;
+        }
+        case Op::SUM_POINTS: {
+            size_t n = trace.varint();
+            trace.expect(n, 16);
+            if (truncated(at)) break;
+            F g = build(trace, n);
+            F& f = profiles[id];
+            timed(op, [&] { f.sum(g); });
+            break;
+        }
+        case Op::EVALUATE: {
+            double x = trace.f64();
+            if (truncated(at)) break;
+            const F& f = profiles[id];
+            double y = 0.0;
+            timed(op, [&] { y = f.evaluate(x); });
+            result.checksum += y;
+            break;
+        }
+        case Op::EVALUATE_MANY: {
+            size_t n = trace.varint();
+            trace.expect(n, 8);
+            if (truncated(at)) break;
+            xs.resize(n);
+            out.resize(n);
+            for (size_t k = 0; k < n; ++k) xs[k] = trace.f64();
+            const F& f = profiles[id];
+            timed(op, [&] { f.evaluate_many(xs.data(), out.data(), n); });
+            for (double y : out) result.checksum += y;
+            break;
+        }
+        case Op::EXPORT: {
+            const F& f = profiles[id];
+            size_t points = 0;
+            timed(op, [&] { points = f.to_points_cumulative().size(); });
+            result.checksum += static_cast<double>(points);
+            break;
+        }
+        case Op::DROP:
+            profiles.erase(id);
+            break;
+        }
+    }
+    return result;
+}
+
+}
+
+#if defined(PIECEWISE_TRACE)
+// Déclare la portée d'un appel public tracé (identité du profil : membre traced)
+#define PWL_TRACE_CALL() ::trace::Call pwl_trace_call(traced)
+#define PWL_TRACE(op, ...) ::trace::op(pwl_trace_call, traced, __VA_ARGS__)
+#define PWL_TRACE_TOUCH() traced.touch()
+#else
+#define PWL_TRACE_CALL() ((void)0)
+#define PWL_TRACE(op, ...) ((void)0)
+#define PWL_TRACE_TOUCH() ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <algorithm>
+
+// Pool de threads minimal : des workers persistants exécutent les indices d'une boucle
+// parallel_for, distribués par un compteur atomique. Le thread appelant participe aussi,
+// donc un pool de taille 1 n'a aucun worker et exécute tout séquentiellement.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency()) {
+        threads = std::max(1u, threads);
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Exécute f(i) pour i dans [0, n) et attend la fin ; la première exception est relancée
+    void parallel_for(size_t n, const std::function<void(size_t)>& f) {
+        if (n == 0) return;
+        if (workers.empty() || n == 1) {
+            for (size_t i = 0; i < n; ++i) f(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &f;
+            job_size = n;
+            next_index.store(0);
+            remaining = n;
+            error = nullptr;
+            ++generation;
+        }
+        wake.notify_all();
+
+        runJob(f, n);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return remaining == 0 && active == 0; });
+        job = nullptr;
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t job_size = 0;
+    std::atomic<size_t> next_index{0};
+    size_t remaining = 0;       // indices pas encore terminés (protégé par mutex)
+    unsigned active = 0;        // workers en train de lire job (protégé par mutex)
+    unsigned long generation = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    // Prend des indices jusqu'à épuisement et décompte ceux qui ont été exécutés
+    void runJob(const std::function<void(size_t)>& f, size_t n) {
+        size_t executed = 0;
+        for (size_t i = next_index.fetch_add(1); i < n; i = next_index.fetch_add(1)) {
+            try {
+                f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+            }
+            ++executed;
+        }
+        if (executed > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            remaining -= executed;
+            if (remaining == 0) done.notify_all();
+        }
+    }
+
+    void workerLoop() {
+        unsigned long seen = 0;
+        for (;;) {
+            const std::function<void(size_t)>* f;
+            size_t n;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || (job && generation != seen); });
+                if (stopping) return;
+                seen = generation;
+                f = job;
+                n = job_size;
+                ++active;
+            }
+            runJob(*f, n);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --active;
+                if (active == 0) done.notify_all();
+            }
+        }
+    }
+};
+
+#endif